@@ -0,0 +1,382 @@
+#include "CLAsyncWriter.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+const uint64_t CLAsyncWriter::CLOSED_BIT_ = 1ull << 63;
+const uint64_t CLAsyncWriter::HEADER_SIZE_ = 8;
+const uint64_t CLAsyncWriter::DATA_TAG_ = 1;
+const uint64_t CLAsyncWriter::PAD_TAG_ = 2;
+const uint64_t CLAsyncWriter::RESERVED_TAG_ = 3;
+const int CLAsyncWriter::BATCH_SIZE_ = IOV_MAX;
+
+// 共享缓冲区的头部，占一个缓存行，之后为环形缓冲区
+struct CLAsyncWriter::RingHeader {
+  uint64_t magic;
+  uint64_t size;                 // 环形缓冲区字节数
+  std::atomic<uint64_t> drained; // 已写出到日志的字节位置
+  uint64_t padding[5];
+};
+static_assert(sizeof(std::atomic<uint64_t>) == 8, "unexpected atomic size");
+static const uint64_t RING_MAGIC = 0x474e4952474c4c43ull; // "CLLGRING"
+
+// 消息内容按 8 字节对齐后的长度
+static inline uint64_t Align8(uint64_t n) { return (n + 7) & ~7ull; }
+
+CLAsyncWriter::CLAsyncWriter(Sink sink, size_t capacity,
+                             const std::string &ring_path)
+    : sink_(sink), buffer_(nullptr), head_(0), tail_(0), written_(0),
+      sleeping_(false), stopped_(false), error_code_(0), ring_(nullptr),
+      ring_fd_(-1) {
+  // 字节数向上取整为 2 的幂
+  size_t size = 64;
+  while (size < capacity)
+    size <<= 1;
+  size_ = size;
+  // 消息不超过缓冲区的一半时，连同占位记录一定能在空缓冲区中放下
+  max_record_ = size_ / 2 - HEADER_SIZE_;
+
+  // 头部为 0 表示该位置尚未提交记录
+  if (ring_path.empty()) {
+    heap_.reset(new uint64_t[size_ / 8]());
+    buffer_ = heap_.get();
+  } else {
+    if (!OpenRing(ring_path, size_, true, sink_, ring_fd_, ring_).IsSuccess())
+      throw "In CLAsyncWriter::CLAsyncWriter(), open ring error";
+    buffer_ = reinterpret_cast<uint64_t *>(ring_ + 1);
+  }
+
+  flusher_ = std::thread(&CLAsyncWriter::FlusherLoop, this);
+}
+
+CLAsyncWriter::~CLAsyncWriter() {
+  Shutdown();
+  if (ring_ != nullptr)
+    CloseRing(ring_fd_, ring_);
+}
+
+CLStatus CLAsyncWriter::Recover(const std::string &ring_path, Sink sink) {
+  int fd;
+  RingHeader *ring;
+  return OpenRing(ring_path, 0, false, sink, fd, ring);
+}
+
+CLStatus CLAsyncWriter::OpenRing(const std::string &ring_path, uint64_t size,
+                                 bool create, Sink sink, int &fd,
+                                 RingHeader *&ring) {
+  // 以 "/" 开头且不含其他 "/" 的名字是共享内存对象，否则是普通文件
+  bool shm = ring_path.size() > 1 && ring_path[0] == '/' &&
+             ring_path.find('/', 1) == std::string::npos;
+  int flags = O_RDWR | O_CLOEXEC | (create ? O_CREAT : 0);
+  fd = shm ? shm_open(ring_path.c_str(), flags, 0600)
+           : open(ring_path.c_str(), flags, 0600);
+  if (fd == -1)
+    return CLStatus(-1, errno);
+
+  // 同一时间只有一个进程使用缓冲区，恢复工具不会动正在运行的进程的缓冲区
+  struct stat st;
+  if (flock(fd, LOCK_EX | LOCK_NB) == -1 || fstat(fd, &st) == -1) {
+    int error = errno;
+    close(fd);
+    return CLStatus(-1, error);
+  }
+
+  // 上次的进程没有写完缓冲区时，先把其中的消息写入日志
+  CLStatus s(0, 0);
+  if ((uint64_t)st.st_size >= sizeof(RingHeader)) {
+    void *p = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                   fd, 0);
+    if (p == MAP_FAILED) {
+      int error = errno;
+      close(fd);
+      return CLStatus(-1, error);
+    }
+    RingHeader *old = static_cast<RingHeader *>(p);
+    uint64_t old_size = old->size;
+    if (old->magic == RING_MAGIC && old_size >= 64 &&
+        (old_size & (old_size - 1)) == 0 &&
+        sizeof(RingHeader) + old_size <= (uint64_t)st.st_size)
+      s = Replay(old, sink);
+    munmap(p, st.st_size);
+    if (!s.IsSuccess()) {
+      close(fd);
+      return s;
+    }
+  }
+
+  // 截断后重新扩展，内容全部为 0；只恢复时留下空文件
+  ring = nullptr;
+  if (ftruncate(fd, 0) == -1 ||
+      (size != 0 && ftruncate(fd, sizeof(RingHeader) + size) == -1)) {
+    int error = errno;
+    close(fd);
+    return CLStatus(-1, error);
+  }
+  if (size == 0) {
+    close(fd);
+    return s;
+  }
+
+  void *p = mmap(nullptr, sizeof(RingHeader) + size, PROT_READ | PROT_WRITE,
+                 MAP_SHARED, fd, 0);
+  if (p == MAP_FAILED) {
+    int error = errno;
+    close(fd);
+    return CLStatus(-1, error);
+  }
+  ring = static_cast<RingHeader *>(p);
+  ring->size = size;
+  ring->drained.store(0);
+  ring->magic = RING_MAGIC;
+  return s;
+}
+
+void CLAsyncWriter::CloseRing(int fd, RingHeader *ring) {
+  munmap(ring, sizeof(RingHeader) + ring->size);
+  close(fd);
+}
+
+CLStatus CLAsyncWriter::Replay(RingHeader *ring, Sink sink) {
+  uint64_t size = ring->size;
+  char *base = reinterpret_cast<char *>(ring + 1);
+  auto header_at = [&](uint64_t pos) {
+    uint64_t header;
+    memcpy(&header, base + (pos & (size - 1)), sizeof(header));
+    return header;
+  };
+
+  // 已提交的记录连续排列，遇到为 0 的头部即到达崩溃时的末尾；
+  // 已预留但未复制完的记录内容不完整，跳过
+  std::vector<struct iovec> iov;
+  uint64_t begin = ring->drained.load();
+  uint64_t pos = begin;
+  uint64_t count = 0;
+  while (pos - begin < size) {
+    uint64_t header = header_at(pos);
+    uint64_t len = header >> 2;
+    uint64_t tag = header & 3;
+    uint64_t offset = pos & (size - 1);
+    if (header == 0 || tag == 0)
+      break;
+    if (tag == PAD_TAG_) {
+      if (len == 0 || offset + len > size)
+        break;
+      pos += len;
+      continue;
+    }
+    if (offset + HEADER_SIZE_ + Align8(len) > size)
+      break;
+    if (tag == DATA_TAG_ && len != 0) {
+      iov.push_back({base + offset + HEADER_SIZE_, len});
+      ++count;
+    }
+    pos += HEADER_SIZE_ + Align8(len);
+  }
+
+  for (size_t i = 0; i < iov.size(); i += BATCH_SIZE_) {
+    int n = std::min<size_t>(BATCH_SIZE_, iov.size() - i);
+    CLStatus s = sink(&iov[i], n);
+    if (!s.IsSuccess())
+      return s;
+  }
+  ring->drained.store(pos);
+  return CLStatus(count, 0);
+}
+
+std::atomic<uint64_t> &CLAsyncWriter::HeaderAt(uint64_t pos) {
+  return *reinterpret_cast<std::atomic<uint64_t> *>(buffer_ +
+                                                    ((pos & (size_ - 1)) >> 3));
+}
+
+CLStatus CLAsyncWriter::Write(const struct iovec *iov, int iovcnt) {
+  uint64_t len = 0;
+  for (int i = 0; i < iovcnt; ++i)
+    len += iov[i].iov_len;
+
+  uint64_t pos = head_.load(std::memory_order_relaxed);
+  if (pos & CLOSED_BIT_)
+    return WriteClosed(iov, iovcnt);
+  if (len > max_record_) {
+    // 消息过大时直接同步写入；先写完之前的消息以保持本线程内的顺序
+    Flush();
+    return sink_(iov, iovcnt);
+  }
+
+  // 通过 CAS 预留记录空间，不加锁；放不下时连同末尾的占位记录一起预留
+  uint64_t need = HEADER_SIZE_ + Align8(len);
+  uint64_t pad;
+  while (true) {
+    if (pos & CLOSED_BIT_)
+      return WriteClosed(iov, iovcnt);
+
+    uint64_t offset = pos & (size_ - 1);
+    pad = offset + need > size_ ? size_ - offset : 0;
+    if (pos + pad + need - tail_.load(std::memory_order_acquire) > size_) {
+      // 缓冲区已满，唤醒刷新线程并让出 CPU
+      WakeFlusher();
+      std::this_thread::yield();
+      pos = head_.load(std::memory_order_relaxed);
+      continue;
+    }
+    if (head_.compare_exchange_weak(pos, pos + pad + need,
+                                    std::memory_order_relaxed))
+      break;
+  }
+
+  if (pad != 0) {
+    HeaderAt(pos).store((pad << 2) | PAD_TAG_, std::memory_order_release);
+    pos += pad;
+  }
+  // 共享缓冲区中先标记已预留，崩溃后恢复时可以跳过这条不完整的记录
+  if (ring_ != nullptr)
+    HeaderAt(pos).store((len << 2) | RESERVED_TAG_, std::memory_order_relaxed);
+
+  // 复制消息内容，最后写入头部提交记录
+  char *data = reinterpret_cast<char *>(buffer_) + (pos & (size_ - 1)) +
+               HEADER_SIZE_;
+  for (int i = 0; i < iovcnt; ++i) {
+    memcpy(data, iov[i].iov_base, iov[i].iov_len);
+    data += iov[i].iov_len;
+  }
+  HeaderAt(pos).store((len << 2) | DATA_TAG_, std::memory_order_release);
+
+  // 与刷新线程设置 sleeping_ 后的再次检查配对，避免丢失唤醒
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (sleeping_.load(std::memory_order_relaxed))
+    WakeFlusher();
+
+  return CLStatus(0, 0);
+}
+
+CLStatus CLAsyncWriter::WriteClosed(const struct iovec *iov, int iovcnt) {
+  // 刷新线程可能还在写出本线程之前的消息，等待 Shutdown 完成后再直接写入
+  std::lock_guard<std::mutex> guard(mutex_for_shutdown_);
+  return sink_(iov, iovcnt);
+}
+
+CLStatus CLAsyncWriter::Flush() {
+  uint64_t target = head_.load(std::memory_order_acquire) & ~CLOSED_BIT_;
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (written_.load() < target && !stopped_) {
+    wake_cv_.notify_one();
+    written_cv_.wait(lock,
+                     [&]() { return written_.load() >= target || stopped_; });
+  }
+
+  if (error_code_ != 0)
+    return CLStatus(-1, error_code_);
+  return CLStatus(0, 0);
+}
+
+CLStatus CLAsyncWriter::Shutdown() {
+  std::lock_guard<std::mutex> guard(mutex_for_shutdown_);
+  if (flusher_.joinable()) {
+    // 置位后不会再有新的预留，刷新线程写完已预留的消息后退出
+    head_.fetch_or(CLOSED_BIT_);
+    WakeFlusher();
+    flusher_.join();
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (error_code_ != 0)
+    return CLStatus(-1, error_code_);
+  return CLStatus(0, 0);
+}
+
+void CLAsyncWriter::WakeFlusher() {
+  { std::lock_guard<std::mutex> lock(mutex_); }
+  wake_cv_.notify_one();
+}
+
+size_t CLAsyncWriter::DrainBatch() {
+  struct iovec iov[BATCH_SIZE_];
+  int count = 0;
+
+  // 收集从 tail_ 开始连续已提交的记录，消息内容直接指向缓冲区
+  uint64_t begin = tail_.load(std::memory_order_relaxed);
+  uint64_t end = begin;
+  // 缓冲区写满时 begin + size_ 处的头部就是 begin 处的头部，最多扫描一圈
+  while (count < BATCH_SIZE_ && end - begin < size_) {
+    uint64_t header = HeaderAt(end).load(std::memory_order_acquire);
+    if (header == 0 || (header & 3) == RESERVED_TAG_)
+      break;
+    uint64_t len = header >> 2;
+    if ((header & 3) == PAD_TAG_) {
+      end += len;
+      continue;
+    }
+    if (len != 0) {
+      iov[count].iov_base = reinterpret_cast<char *>(buffer_) +
+                            (end & (size_ - 1)) + HEADER_SIZE_;
+      iov[count].iov_len = len;
+      ++count;
+    }
+    end += HEADER_SIZE_ + Align8(len);
+  }
+  if (end == begin)
+    return 0;
+
+  CLStatus s = count > 0 ? sink_(iov, count) : CLStatus(0, 0);
+  // 先记录已写出的位置再清零，崩溃后恢复时不会从清零的区域开始
+  if (ring_ != nullptr)
+    ring_->drained.store(end, std::memory_order_release);
+
+  // 清零已消费的区域（最多跨越缓冲区末尾一次），之后才归还给生产者
+  char *base = reinterpret_cast<char *>(buffer_);
+  uint64_t from = begin & (size_ - 1);
+  uint64_t bytes = end - begin;
+  if (from + bytes > size_) {
+    memset(base + from, 0, size_ - from);
+    memset(base, 0, from + bytes - size_);
+  } else {
+    memset(base + from, 0, bytes);
+  }
+  tail_.store(end, std::memory_order_release);
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!s.IsSuccess())
+      error_code_ = s.ErrorCode();
+    written_.store(end);
+  }
+  written_cv_.notify_all();
+  return bytes;
+}
+
+void CLAsyncWriter::FlusherLoop() {
+  while (true) {
+    if (DrainBatch() > 0)
+      continue;
+
+    uint64_t head = head_.load(std::memory_order_acquire);
+    if (tail_.load(std::memory_order_relaxed) != (head & ~CLOSED_BIT_)) {
+      // 空间已预留但记录尚未提交
+      std::this_thread::yield();
+      continue;
+    }
+    if (head & CLOSED_BIT_)
+      break;
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    sleeping_.store(true, std::memory_order_seq_cst);
+    if (HeaderAt(tail_.load(std::memory_order_relaxed))
+                .load(std::memory_order_acquire) == 0 &&
+        !(head_.load() & CLOSED_BIT_))
+      wake_cv_.wait_for(lock, std::chrono::milliseconds(100));
+    sleeping_.store(false, std::memory_order_relaxed);
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  stopped_ = true;
+  written_cv_.notify_all();
+}
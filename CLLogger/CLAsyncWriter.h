@@ -0,0 +1,87 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <sys/uio.h>
+#include <thread>
+
+#include "CLLogWriter.h"
+
+// 异步写入后端：生产者线程把消息复制进无锁多生产者字节环形缓冲区后立即返回，
+// 由一个后台刷新线程成批取出消息并用 writev 一次写入文件。
+// 消息以记录的形式直接存放在环形缓冲区中：8 字节头部之后紧跟消息内容，
+// 按 8 字节对齐；记录不跨越缓冲区末尾，放不下时先填充一条占位记录。
+// 写入路径上没有堆分配，消息只被复制一次。
+// 指定 ring_path 时缓冲区放在命名共享内存（以 "/" 开头且不含其他 "/"，
+// 经 shm_open 打开）或映射的文件中，头部记录已写出的位置：进程崩溃后
+// 已提交的消息仍在其中，下次打开或由 CLLogDrain 写入日志，热路径上没有 fsync
+class CLAsyncWriter : public CLLogWriter {
+public:
+  // 将一组 iovec 完整写入文件的回调
+  typedef std::function<CLStatus(const struct iovec *, int)> Sink;
+
+  // capacity 为缓冲区字节数，取 2 的幂；ring_path 非空时先恢复其中未写出的消息
+  CLAsyncWriter(Sink sink, size_t capacity,
+                const std::string &ring_path = std::string());
+  virtual ~CLAsyncWriter();
+
+  // 把 ring_path 中崩溃前未写出的消息写入 sink 并清空缓冲区，
+  // 返回值的 ReturnCode 为恢复的消息条数；缓冲区正被其他进程使用时失败
+  static CLStatus Recover(const std::string &ring_path, Sink sink);
+
+  virtual CLStatus Write(const struct iovec *iov, int iovcnt);
+  virtual CLStatus Flush();
+  virtual CLStatus Shutdown();
+
+private:
+  CLAsyncWriter(const CLAsyncWriter &) = delete;
+  CLAsyncWriter &operator=(const CLAsyncWriter &) = delete;
+
+  // 关闭后的写入：等待已缓冲的消息写完后直接写入文件
+  CLStatus WriteClosed(const struct iovec *iov, int iovcnt);
+  void FlusherLoop();
+  size_t DrainBatch(); // 写出一批已就绪的记录，返回消费的字节数
+  void WakeFlusher();
+  std::atomic<uint64_t> &HeaderAt(uint64_t pos);
+
+  struct RingHeader; // 共享缓冲区的头部
+  // 打开并锁定共享缓冲区，写出其中未写出的记录后按 size 重新映射并清空
+  static CLStatus OpenRing(const std::string &ring_path, uint64_t size,
+                           bool create, Sink sink, int &fd, RingHeader *&ring);
+  static void CloseRing(int fd, RingHeader *ring);
+  // 从已写出的位置开始写出连续的已提交记录，跳过未复制完的记录
+  static CLStatus Replay(RingHeader *ring, Sink sink);
+
+  Sink sink_;
+  std::unique_ptr<uint64_t[]> heap_; // 不使用共享缓冲区时在堆上分配
+  uint64_t *buffer_;                 // 按 8 字节对齐的环形缓冲区
+  uint64_t size_;                      // 缓冲区字节数
+  uint64_t max_record_;                // 可放入缓冲区的最大消息长度
+
+  alignas(64) std::atomic<uint64_t> head_; // 生产者预留的下一个字节位置
+  alignas(64) std::atomic<uint64_t> tail_; // 刷新线程读取的下一个字节位置
+  std::atomic<uint64_t> written_;          // 已写入文件的字节位置
+
+  std::thread flusher_;
+  std::mutex mutex_;                   // 配合条件变量使用
+  std::condition_variable wake_cv_;    // 唤醒刷新线程
+  std::condition_variable written_cv_; // 通知等待 Flush 的线程
+  std::atomic<bool> sleeping_;         // 刷新线程是否正在休眠
+  bool stopped_;                       // 刷新线程已退出
+  long error_code_;                    // 最近一次写入失败的 errno
+  std::mutex mutex_for_shutdown_;      // 串行化 Shutdown，关闭后的写入等待其完成
+  RingHeader *ring_;                   // 共享缓冲区的头部，未使用时为空
+  int ring_fd_;
+
+  static const uint64_t CLOSED_BIT_; // head_ 的最高位，置位后不再接受新消息
+  static const uint64_t HEADER_SIZE_; // 记录头部字节数
+  static const uint64_t DATA_TAG_;    // 头部低位：消息记录
+  static const uint64_t PAD_TAG_;     // 头部低位：占位记录
+  static const uint64_t RESERVED_TAG_; // 头部低位：已预留，内容尚未复制完
+  static const int BATCH_SIZE_;       // 每次 writev 的最大记录条数
+};
@@ -0,0 +1,92 @@
+#include "CLBinaryLog.h"
+
+#include <sys/uio.h>
+#include <time.h>
+
+#include "CLFileRW.h"
+
+std::atomic<uint32_t> CLLogSite::next_id_(0);
+std::atomic<uint64_t> CLBinaryLog::clock_generation_(UINT64_MAX);
+std::atomic<uint64_t> CLBinaryLog::clock_synced_at_(0);
+const uint64_t CLBinaryLog::CLOCK_SYNC_INTERVAL_NS_ = 1000000000;
+
+CLLogSite::CLLogSite(CLLogLevel level, const char *fmt, const char *file,
+                     int line)
+    : generation(UINT64_MAX), id_(next_id_.fetch_add(1)), level_(level) {
+  size_t fmt_len = strlen(fmt);
+  size_t file_len = strlen(file);
+  size_t payload = 4 + 4 + 4 + 4 + file_len + 4 + fmt_len;
+
+  dict_.resize(CLBinaryFormat::HEADER_SIZE + payload + 1);
+  char *p = CLBinaryLog::PutHeader(&dict_[0], CLBinaryFormat::DICT, payload);
+  uint32_t fields[4] = {id_, static_cast<uint32_t>(line),
+                        static_cast<uint32_t>(level),
+                        static_cast<uint32_t>(file_len)};
+  memcpy(p, fields, sizeof(fields));
+  p += sizeof(fields);
+  memcpy(p, file, file_len);
+  p += file_len;
+  uint32_t len = fmt_len;
+  memcpy(p, &len, sizeof(len));
+  p += sizeof(len);
+  memcpy(p, fmt, fmt_len);
+  p += fmt_len;
+  *p = CLBinaryFormat::TRAILER;
+}
+
+char *CLBinaryLog::PutHeader(char *p, unsigned char type, uint32_t payload) {
+  *p++ = CLBinaryFormat::MAGIC0;
+  *p++ = CLBinaryFormat::MAGIC1;
+  *p++ = type;
+  return Put(p, payload);
+}
+
+uint64_t CLBinaryLog::Now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+  return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+CLStatus CLBinaryLog::Commit(CLLogSite &site, uint64_t now, const char *entry,
+                             size_t len) {
+  CLFileRW *file = CLFileRW::Instance();
+
+  // 调用点第一次写入或当前段轮转后，字典记录与条目作为同一条消息写入，
+  // 两者落在同一个段中；并发时可能重复写入字典记录，解码时以后者为准
+  struct iovec iov[3];
+  int iovcnt = 0;
+  uint64_t generation = file->segments_->Generation();
+
+  // 每个段开头附近以及每隔一段时间写一条时钟记录，
+  // 解码时据此把单调时钟换算为实时时钟，并跟随实时时钟的调整
+  char clock[CLBinaryFormat::HEADER_SIZE + 16 + 1];
+  if (clock_generation_.load(std::memory_order_relaxed) != generation ||
+      now - clock_synced_at_.load(std::memory_order_relaxed) >=
+          CLOCK_SYNC_INTERVAL_NS_) {
+    clock_generation_.store(generation, std::memory_order_relaxed);
+    clock_synced_at_.store(now, std::memory_order_relaxed);
+
+    struct timespec mono, real;
+    clock_gettime(CLOCK_MONOTONIC, &mono);
+    clock_gettime(CLOCK_REALTIME, &real);
+    char *p = PutHeader(clock, CLBinaryFormat::CLOCK, 16);
+    p = Put(p, mono.tv_sec * 1000000000ull + mono.tv_nsec);
+    p = Put(p, real.tv_sec * 1000000000ull + real.tv_nsec);
+    *p = CLBinaryFormat::TRAILER;
+    iov[iovcnt].iov_base = clock;
+    iov[iovcnt].iov_len = sizeof(clock);
+    ++iovcnt;
+  }
+
+  if (site.generation.load(std::memory_order_relaxed) != generation) {
+    site.generation.store(generation, std::memory_order_relaxed);
+    iov[iovcnt].iov_base = const_cast<char *>(site.DictRecord().data());
+    iov[iovcnt].iov_len = site.DictRecord().size();
+    ++iovcnt;
+  }
+  iov[iovcnt].iov_base = const_cast<char *>(entry);
+  iov[iovcnt].iov_len = len;
+  ++iovcnt;
+
+  return file->FWrite(iov, iovcnt);
+}
@@ -0,0 +1,181 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#include "CLLogLevel.h"
+#include "CLStatus.h"
+
+// 结构化二进制日志：调用点的格式串只在字典记录中写一次，之后每条日志
+// 只写调用点编号、时间戳与各参数的二进制值，格式化推迟到离线解码时进行。
+//
+// 记录格式（整数为本机字节序）：
+//   [0x00][0xB1][类型][负载长度 u32][负载][0x0A]
+// 类型 'D' 为字典记录，负载为编号 u32、行号 u32、级别 u32、文件名与
+// 格式串（各为长度 u32 加内容）；类型 'E' 为条目记录，负载为编号 u32、
+// 时间戳 u64 以及各参数，每个参数以一个类型字节开头：
+// 'i' int64、'u' uint64、'd' double、'p' 指针 u64、's' 长度 u32 加内容；
+// 类型 'C' 为时钟记录，负载为同一时刻的单调时钟与实时时钟 u64（纳秒）。
+// 条目的时间戳取自 CLOCK_MONOTONIC_COARSE，解码时按最近的时钟记录换算。
+// 记录以 0x00 开头，可与普通文本消息混写在同一个日志中
+namespace CLBinaryFormat {
+const unsigned char MAGIC0 = 0x00;
+const unsigned char MAGIC1 = 0xB1;
+const unsigned char DICT = 'D';
+const unsigned char ENTRY = 'E';
+const unsigned char CLOCK = 'C';
+const unsigned char TRAILER = '\n';
+const size_t HEADER_SIZE = 7; // 魔数、类型与负载长度
+
+const char ARG_INT = 'i';
+const char ARG_UINT = 'u';
+const char ARG_DOUBLE = 'd';
+const char ARG_POINTER = 'p';
+const char ARG_STRING = 's';
+} // namespace CLBinaryFormat
+
+// 一个日志调用点，由 CL_BLOG 定义为函数内的静态对象
+class CLLogSite {
+public:
+  CLLogSite(CLLogLevel level, const char *fmt, const char *file, int line);
+
+  uint32_t Id() const { return id_; }
+  CLLogLevel Level() const { return level_; }
+  const std::string &DictRecord() const { return dict_; }
+
+  // 最近一次写入字典记录时的段轮转次数，轮转后重新写入，
+  // 保证每个段都能单独解码
+  std::atomic<uint64_t> generation;
+
+private:
+  CLLogSite(const CLLogSite &) = delete;
+  CLLogSite &operator=(const CLLogSite &) = delete;
+
+  uint32_t id_;
+  CLLogLevel level_;
+  std::string dict_; // 预先编码好的字典记录
+
+  static std::atomic<uint32_t> next_id_;
+};
+
+class CLBinaryLog {
+public:
+  // 编码一条日志并作为一条消息写入 CLFileRW，调用线程只复制参数
+  template <typename... Args>
+  static CLStatus Write(CLLogSite &site, const Args &...args) {
+    size_t payload = 4 + 8 + (ArgSize(args) + ... + 0);
+    size_t total = CLBinaryFormat::HEADER_SIZE + payload + 1;
+
+    char stack[512];
+    std::unique_ptr<char[]> heap;
+    char *buf = stack;
+    if (total > sizeof(stack)) {
+      heap.reset(new char[total]);
+      buf = heap.get();
+    }
+
+    uint64_t now = Now();
+    char *p = PutHeader(buf, CLBinaryFormat::ENTRY, payload);
+    p = Put(p, site.Id());
+    p = Put(p, now);
+    ((p = Encode(p, args)), ...);
+    *p = CLBinaryFormat::TRAILER;
+
+    return Commit(site, now, buf, total);
+  }
+
+  // 只用于让编译器按 printf 规则检查 CL_BLOG 的参数，不会被调用
+  __attribute__((format(printf, 1, 2))) static void
+  CheckFormat(const char *, ...) {}
+
+  static char *PutHeader(char *p, unsigned char type, uint32_t payload);
+
+private:
+  template <typename T> struct IsString {
+    static const bool value = std::is_same<T, const char *>::value ||
+                              std::is_same<T, char *>::value ||
+                              std::is_same<T, std::string>::value ||
+                              std::is_same<T, std::string_view>::value;
+  };
+
+  template <typename T> static char *Put(char *p, T value) {
+    memcpy(p, &value, sizeof(value));
+    return p + sizeof(value);
+  }
+
+  static std::string_view StringOf(const char *s) {
+    return s ? std::string_view(s) : std::string_view("(null)");
+  }
+  static std::string_view StringOf(std::string_view s) { return s; }
+
+  template <typename T> static size_t ArgSize(const T &value) {
+    typedef std::decay_t<T> U;
+    if constexpr (IsString<U>::value)
+      return 1 + 4 + StringOf(value).size();
+    else
+      return 1 + 8;
+  }
+
+  template <typename T> static char *Encode(char *p, const T &value) {
+    typedef std::decay_t<T> U;
+    if constexpr (IsString<U>::value) {
+      std::string_view s = StringOf(value);
+      *p++ = CLBinaryFormat::ARG_STRING;
+      p = Put(p, static_cast<uint32_t>(s.size()));
+      memcpy(p, s.data(), s.size());
+      return p + s.size();
+    } else if constexpr (std::is_floating_point<U>::value) {
+      *p++ = CLBinaryFormat::ARG_DOUBLE;
+      return Put(p, static_cast<double>(value));
+    } else if constexpr (std::is_pointer<U>::value ||
+                         std::is_null_pointer<U>::value) {
+      *p++ = CLBinaryFormat::ARG_POINTER;
+      return Put(p, static_cast<uint64_t>(
+                        reinterpret_cast<uintptr_t>(value)));
+    } else if constexpr (std::is_enum<U>::value) {
+      return Encode(p, static_cast<std::underlying_type_t<U>>(value));
+    } else if constexpr (std::is_signed<U>::value) {
+      *p++ = CLBinaryFormat::ARG_INT;
+      return Put(p, static_cast<int64_t>(value));
+    } else {
+      static_assert(std::is_unsigned<U>::value,
+                    "unsupported binary log argument type");
+      *p++ = CLBinaryFormat::ARG_UINT;
+      return Put(p, static_cast<uint64_t>(value));
+    }
+  }
+
+  // 粗粒度单调时钟（纳秒），经 vDSO 读取，精度为一个时钟节拍
+  static uint64_t Now();
+  static CLStatus Commit(CLLogSite &site, uint64_t now, const char *entry,
+                         size_t len);
+
+  static std::atomic<uint64_t> clock_generation_; // 最近写入时钟记录的段代数
+  static std::atomic<uint64_t> clock_synced_at_;  // 最近写入时钟记录的时间
+  static const uint64_t CLOCK_SYNC_INTERVAL_NS_;  // 时钟记录的最长间隔
+};
+
+// 按级别写一条结构化日志，level 为 CLLogLevel 的枚举名（如 Warn），
+// fmt 必须是字符串字面量，参数按 printf 规则检查。
+// 级别低于 CL_LOG_MIN_LEVEL 时整条语句不生成代码，参数也不会求值；
+// 低于运行期级别时只执行一次原子读
+#define CL_LOG(level, fmt, ...)                                                \
+  do {                                                                         \
+    if constexpr (CLLogLevel::level >= CL_LOG_COMPILED_MIN) {                  \
+      if (CLLogThreshold::Enabled(CLLogLevel::level)) {                        \
+        static CLLogSite cl_log_site_(CLLogLevel::level, fmt, __FILE__,        \
+                                      __LINE__);                               \
+        if (false)                                                             \
+          CLBinaryLog::CheckFormat(fmt, ##__VA_ARGS__);                        \
+        CLBinaryLog::Write(cl_log_site_, ##__VA_ARGS__);                       \
+      }                                                                        \
+    }                                                                          \
+  } while (0)
+
+// Info 级别的结构化日志
+#define CL_BLOG(fmt, ...) CL_LOG(Info, fmt, ##__VA_ARGS__)
@@ -0,0 +1,132 @@
+#include "CLBlockCache.h"
+
+#include <algorithm>
+#include <cstring>
+
+const size_t CLBlockCache::SHARD_COUNT_ = 16;
+
+// 每个线程最近一次读取的结束位置，用于识别顺序读
+struct CLReadCursor {
+  const CLBlockCache *cache = nullptr;
+  uint64_t next = 0;
+};
+static thread_local CLReadCursor cursor_;
+
+CLBlockCache::CLBlockCache(size_t page_size, size_t capacity,
+                           size_t readahead_pages)
+    : page_size_(page_size),
+      readahead_pages_(std::max<size_t>(1, readahead_pages)),
+      shards_(SHARD_COUNT_), hits_(0), misses_(0), readahead_(0) {
+  shard_capacity_ = std::max<size_t>(1, capacity / page_size_ / SHARD_COUNT_);
+}
+
+CLBlockCache::Shard &CLBlockCache::ShardOf(uint64_t page) {
+  // 相邻的页落在不同分片上，顺序读者不会集中在一把锁上
+  return shards_[page % SHARD_COUNT_];
+}
+
+CLBlockCache::Page CLBlockCache::Lookup(uint64_t page) {
+  Shard &shard = ShardOf(page);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  auto it = shard.index.find(page);
+  if (it == shard.index.end())
+    return nullptr;
+  shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+  return it->second->second;
+}
+
+void CLBlockCache::Insert(uint64_t page, Page data) {
+  Shard &shard = ShardOf(page);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  auto it = shard.index.find(page);
+  if (it != shard.index.end()) {
+    shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+    return;
+  }
+
+  shard.lru.emplace_front(page, data);
+  shard.index[page] = shard.lru.begin();
+  if (shard.lru.size() > shard_capacity_) {
+    shard.index.erase(shard.lru.back().first);
+    shard.lru.pop_back();
+  }
+}
+
+CLStatus CLBlockCache::Read(uint64_t offset, char *buf, size_t len,
+                            uint64_t end, const Loader &loader) {
+  if (offset >= end)
+    return CLStatus(0, 0);
+  len = std::min<uint64_t>(len, end - offset);
+
+  bool sequential = cursor_.cache == this && cursor_.next == offset;
+  cursor_.cache = this;
+  cursor_.next = offset + len;
+
+  // 只有整页都在 end 之前的页才进入缓存
+  uint64_t full_pages = end / page_size_;
+  size_t done = 0;
+  while (done < len) {
+    uint64_t pos = offset + done;
+    uint64_t page = pos / page_size_;
+    size_t in_page = pos % page_size_;
+    size_t n = std::min<size_t>(page_size_ - in_page, len - done);
+
+    if (page >= full_pages) {
+      // 最后一页尚未写满，直接读文件
+      misses_.fetch_add(1, std::memory_order_relaxed);
+      CLStatus s = loader(pos, buf + done, n);
+      if (!s.IsSuccess())
+        return done > 0 ? CLStatus(done, 0) : s;
+      done += s.ReturnCode();
+      if ((size_t)s.ReturnCode() < n)
+        break;
+      continue;
+    }
+
+    Page data = Lookup(page);
+    if (data != nullptr) {
+      hits_.fetch_add(1, std::memory_order_relaxed);
+      memcpy(buf + done, data.get() + in_page, n);
+      done += n;
+      continue;
+    }
+
+    // 未命中：顺序读时连同后面的页一起读入，减少读文件的次数
+    misses_.fetch_add(1, std::memory_order_relaxed);
+    uint64_t count = sequential ? readahead_pages_ : 1;
+    count = std::min<uint64_t>(count, full_pages - page);
+    Page chunk(new char[count * page_size_]);
+    CLStatus s = loader(page * page_size_, chunk.get(), count * page_size_);
+    if (!s.IsSuccess())
+      return done > 0 ? CLStatus(done, 0) : s;
+    uint64_t loaded = s.ReturnCode() / page_size_;
+    if (loaded == 0)
+      break;
+    if (loaded > 1)
+      readahead_.fetch_add(loaded - 1, std::memory_order_relaxed);
+
+    // 每页单独分配：页在不同分片中分别淘汰，共享一块内存时只要有一页
+    // 留在缓存中整块就不会释放，实际占用会超出容量
+    if (count == 1) {
+      Insert(page, chunk);
+    } else {
+      for (uint64_t i = 0; i < loaded; ++i) {
+        Page copy(new char[page_size_]);
+        memcpy(copy.get(), chunk.get() + i * page_size_, page_size_);
+        Insert(page + i, copy);
+      }
+    }
+    memcpy(buf + done, chunk.get() + in_page, n);
+    done += n;
+  }
+
+  return CLStatus(done, 0);
+}
+
+CLCacheStats CLBlockCache::Stats() const {
+  CLCacheStats stats;
+  stats.hits = hits_.load(std::memory_order_relaxed);
+  stats.misses = misses_.load(std::memory_order_relaxed);
+  stats.readahead = readahead_.load(std::memory_order_relaxed);
+  return stats;
+}
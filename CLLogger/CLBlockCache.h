@@ -0,0 +1,66 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "CLStatus.h"
+
+// 块缓存的命中统计
+struct CLCacheStats {
+  uint64_t hits = 0;      // 命中缓存的页数
+  uint64_t misses = 0;    // 未命中、需要读文件的次数
+  uint64_t readahead = 0; // 顺序读时预读的页数
+};
+
+// 日志的按页块缓存：日志只追加，完全位于已写入范围内的页内容不再变化，
+// 可以直接缓存。页按编号分散到多个分片，每个分片有自己的锁和 LRU 链表，
+// 并发读者很少争用同一把锁。同一线程连续顺序读时，未命中一次读入多页
+class CLBlockCache {
+public:
+  // 从日志偏移 offset 处读取 len 字节到 buf，返回值的 ReturnCode 为读取的字节数
+  typedef std::function<CLStatus(uint64_t, char *, size_t)> Loader;
+
+  // capacity 为缓存的总字节数，readahead_pages 为顺序读时一次读入的页数
+  CLBlockCache(size_t page_size, size_t capacity, size_t readahead_pages);
+
+  // 读取 [offset, offset + len) 中位于 end 之前的部分，
+  // end 之前的内容必须已经写入且不再变化；返回值的 ReturnCode 为读取的字节数
+  CLStatus Read(uint64_t offset, char *buf, size_t len, uint64_t end,
+                const Loader &loader);
+
+  CLCacheStats Stats() const;
+
+private:
+  CLBlockCache(const CLBlockCache &) = delete;
+  CLBlockCache &operator=(const CLBlockCache &) = delete;
+
+  typedef std::shared_ptr<char[]> Page;
+  typedef std::list<std::pair<uint64_t, Page>> PageList;
+
+  struct Shard {
+    std::mutex mutex;
+    PageList lru; // 表头为最近使用的页
+    std::unordered_map<uint64_t, PageList::iterator> index;
+  };
+
+  Shard &ShardOf(uint64_t page);
+  Page Lookup(uint64_t page);
+  void Insert(uint64_t page, Page data);
+
+  size_t page_size_;
+  size_t shard_capacity_; // 每个分片缓存的页数
+  size_t readahead_pages_;
+  std::vector<Shard> shards_;
+
+  std::atomic<uint64_t> hits_;
+  std::atomic<uint64_t> misses_;
+  std::atomic<uint64_t> readahead_;
+
+  static const size_t SHARD_COUNT_;
+};
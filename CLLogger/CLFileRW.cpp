@@ -1,5 +1,12 @@
 #include "CLFileRW.h"
+#include "CLAsyncWriter.h"
+#include "CLMmapWriter.h"
+#include "CLStagedWriter.h"
 #include "CLStatus.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <climits>
 #include <cstdlib>
 #include <cstring>
 #include <fcntl.h>
@@ -11,26 +18,234 @@
 const std::string CLFileRW::LOG_FILE_NAME_ = "temp.txt";
 const int CLFileRW::BUFFER_SIZE_ = 4096;
 std::shared_ptr<CLFileRW> CLFileRW::instance_ = nullptr;
+std::atomic<CLFileRW *> CLFileRW::instance_ptr_(nullptr);
 std::mutex CLFileRW::mutex_for_creating_file_;
 std::mutex CLFileRW::mutex_for_use_file_;
 std::mutex CLFileRW::mutex_for_write_;
-std::mutex CLFileRW::mutex_for_read_;
+CLFileRWConfig CLFileRW::config_;
 
 CLFileRW::CLFileRW() {
-  m_Fd = open(LOG_FILE_NAME_.c_str(), O_RDWR | O_CREAT | O_APPEND,
-              S_IRUSR | S_IWUSR);
-  if (m_Fd == -1)
+  segments_.reset(new CLLogSegments(
+      config_.path.empty() ? LOG_FILE_NAME_ : config_.path,
+      config_.rotate_bytes, config_.rotate_interval_s, config_.retention,
+      config_.compress_rotated));
+  if (!segments_->Open().IsSuccess())
     throw "In CLFileRW::CLFileRW(), open error";
+
+  if (config_.cache_bytes != 0)
+    cache_.reset(new CLBlockCache(config_.cache_page_size, config_.cache_bytes,
+                                  config_.readahead_pages));
+
+  if (config_.mode == CLWriteMode::Async) {
+    writer_.reset(new CLAsyncWriter(
+        [this](const struct iovec *iov, int iovcnt) {
+          return WriteVector(iov, iovcnt);
+        },
+        config_.ring_capacity, config_.ring_path));
+  } else if (config_.mode == CLWriteMode::Staged) {
+    writer_.reset(new CLStagedWriter(
+        [this](const struct iovec *iov, int iovcnt) {
+          return WriteVector(iov, iovcnt);
+        },
+        config_.staging_buffer_size, config_.commit_interval_ms));
+  } else if (config_.mode == CLWriteMode::Mmap) {
+    writer_.reset(new CLMmapWriter(
+        segments_->ActiveFd(),
+        CLMmapWriter::MarkerPath(config_.path.empty() ? LOG_FILE_NAME_
+                                                      : config_.path),
+        [this](const struct iovec *iov, int iovcnt) {
+          return WriteVector(iov, iovcnt);
+        },
+        [this](uint64_t n) { NoteWritten(n); }, config_.mmap_extent_size,
+        config_.mmap_max_size));
+  } else if (config_.mode == CLWriteMode::Sharded) {
+    // 分片写在 path.sK 中，path 本身保持为空
+    CLShardedWriter *sharded = new CLShardedWriter(
+        config_.path.empty() ? LOG_FILE_NAME_ : config_.path,
+        config_.shard_count, [this](uint64_t n) { NoteWritten(n); });
+    writer_.reset(sharded);
+    merger_.reset(new CLShardMerger(sharded->ShardPaths()));
+  }
+
+  if (config_.durability == CLDurability::IntervalMs ||
+      config_.durability == CLDurability::Bytes)
+    syncer_ = std::thread(&CLFileRW::SyncLoop, this);
 }
 
 CLFileRW::~CLFileRW() {
   // 程序退出时，需要自动刷新缓存并关闭文件
-  Flush();
-  close(m_Fd);
+  Shutdown();
+  segments_->Close();
+}
+
+CLStatus CLFileRW::Configure(const CLFileRWConfig &config) {
+  std::lock_guard<std::mutex> lock(mutex_for_creating_file_);
+  if (instance_ != nullptr)
+    return CLStatus(-1, 0); // 文件操作对象已创建，配置不再生效
+  // 映射绑定在一个文件上，映射模式不支持轮转；分片模式的各分片也不轮转
+  if ((config.mode == CLWriteMode::Mmap ||
+       config.mode == CLWriteMode::Sharded) &&
+      (config.rotate_bytes != 0 || config.rotate_interval_s != 0))
+    return CLStatus(-1, EINVAL);
+  // 共享缓冲区只用于异步模式，其他模式下指定时消息不会在崩溃后保留
+  if (!config.ring_path.empty() && config.mode != CLWriteMode::Async)
+    return CLStatus(-1, EINVAL);
+  config_ = config;
+  return CLStatus(0, 0);
+}
+
+CLStatus CLFileRW::Shutdown() {
+  CLStatus s = writer_ ? writer_->Shutdown() : Flush();
+
+  // 之后不再等待新数据，唤醒所有跟随的读者
+  {
+    std::lock_guard<std::mutex> lock(mutex_for_follow_);
+    follow_closed_ = true;
+  }
+  follow_cv_.notify_all();
+
+  if (syncer_.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_for_sync_);
+      sync_stop_ = true;
+    }
+    syncer_cv_.notify_one();
+    syncer_.join();
+  }
+
+  // 配置了持久化级别时，退出前把剩余数据落盘
+  if (config_.durability != CLDurability::None) {
+    CLStatus r = SyncTo(written_bytes_.load());
+    if (s.IsSuccess())
+      return r;
+  }
+  return s;
+}
+
+CLStatus CLFileRW::Sync() {
+  CLStatus s = Flush();
+  if (!s.IsSuccess())
+    return s;
+  return SyncTo(written_bytes_.load());
+}
+
+CLStatus CLFileRW::SyncTo(uint64_t target) {
+  std::unique_lock<std::mutex> lock(mutex_for_sync_);
+
+  // 分组落盘：没有线程在执行 fdatasync 时由当前线程执行，
+  // 覆盖开始时已写入的全部数据；其他线程等待其结果
+  while (synced_bytes_ < target) {
+    if (syncing_) {
+      sync_cv_.wait(lock);
+      continue;
+    }
+
+    syncing_ = true;
+    uint64_t covered = written_bytes_.load();
+    lock.unlock();
+    CLStatus r =
+        config_.mode == CLWriteMode::Sharded
+            ? static_cast<CLShardedWriter *>(writer_.get())->Sync()
+            : segments_->Sync();
+    lock.lock();
+    syncing_ = false;
+    sync_cv_.notify_all();
+
+    if (!r.IsSuccess())
+      return r;
+    if (covered > synced_bytes_)
+      synced_bytes_ = covered;
+  }
+
+  return CLStatus(0, 0);
+}
+
+void CLFileRW::SyncLoop() {
+  std::unique_lock<std::mutex> lock(mutex_for_sync_);
+  while (!sync_stop_) {
+    if (config_.durability == CLDurability::IntervalMs)
+      syncer_cv_.wait_for(lock,
+                          std::chrono::milliseconds(config_.sync_interval_ms));
+    else
+      syncer_cv_.wait(lock, [this]() {
+        return sync_stop_ ||
+               written_bytes_.load() - synced_bytes_ >= config_.sync_bytes;
+      });
+    if (sync_stop_)
+      break;
+
+    uint64_t target = written_bytes_.load();
+    if (target > synced_bytes_) {
+      lock.unlock();
+      SyncTo(target);
+      lock.lock();
+    }
+  }
+}
+
+CLStatus CLFileRW::WriteVector(const struct iovec *iov, int iovcnt) {
+  std::lock_guard<std::mutex> file_lock(mutex_for_use_file_);
+  return WriteVectorLocked(iov, iovcnt);
+}
+
+CLStatus CLFileRW::WriteVectorLocked(const struct iovec *iov, int iovcnt) {
+  // 写入当前段；轮转只替换当前段指针，不会等待这里的写入
+  CLLogFile *file = segments_->Acquire();
+  uint64_t total = 0;
+  CLStatus s(0, 0);
+
+  // 每次最多提交 IOV_MAX 段；writev 可能只写入一部分，
+  // 跳过已写完的缓冲区后继续写
+  struct iovec rest[IOV_MAX];
+  while (iovcnt > 0 && s.IsSuccess()) {
+    int cnt = iovcnt < IOV_MAX ? iovcnt : IOV_MAX;
+    memcpy(rest, iov, cnt * sizeof(struct iovec));
+    iov += cnt;
+    iovcnt -= cnt;
+
+    int first = 0;
+    while (first < cnt) {
+      ssize_t n = writev(file->fd, &rest[first], cnt - first);
+      if (n == -1) {
+        if (errno == EINTR)
+          continue;
+        s = CLStatus(-1, errno);
+        break;
+      }
+      total += n;
+      while (first < cnt && (size_t)n >= rest[first].iov_len) {
+        n -= rest[first].iov_len;
+        ++first;
+      }
+      if (first < cnt) {
+        rest[first].iov_base = (char *)rest[first].iov_base + n;
+        rest[first].iov_len -= n;
+      }
+    }
+  }
+
+  segments_->Release(file, total);
+  NoteWritten(total);
+  return s;
+}
+
+void CLFileRW::NoteWritten(uint64_t n) {
+  uint64_t written = written_bytes_.fetch_add(n) + n;
+
+  // 没有等待新数据的读者时只有一次原子读
+  if (followers_waiting_.load() != 0)
+    NotifyFollowers();
+
+  // 未落盘数据达到阈值时唤醒后台落盘线程
+  if (config_.durability == CLDurability::Bytes &&
+      written - synced_bytes_.load() >= config_.sync_bytes) {
+    { std::lock_guard<std::mutex> lock(mutex_for_sync_); }
+    syncer_cv_.notify_one();
+  }
 }
 
 CLStatus CLFileRW::FileWrite(const char *wMsg) {
-  std::shared_ptr<CLFileRW> pFile = CLFileRW::GetInstance(); // 获取文件操作对象
+  CLFileRW *pFile = CLFileRW::Instance(); // 获取文件操作对象
   CLStatus s = pFile->FWrite(wMsg);
   if (s.IsSuccess())
     return CLStatus(0, 0);
@@ -48,23 +263,61 @@ CLStatus CLFileRW::FileWrite(const char *wMsg) {
   // }
 }
 
+CLStatus CLFileRW::FileWrite(const void *wMsg, size_t len) {
+  CLFileRW *pFile = CLFileRW::Instance(); // 获取文件操作对象
+  return pFile->FWrite(wMsg, len);
+}
+
 CLStatus CLFileRW::FWrite(const char *wMsg) {
 
   if (wMsg == 0)
     return CLStatus(-1, 0);
-  int len_strmsg = strlen(wMsg);
 
-  if (len_strmsg == 0)
+  return FWrite(wMsg, strlen(wMsg));
+}
+
+CLStatus CLFileRW::FWrite(std::string_view wMsg) {
+  return FWrite(wMsg.data(), wMsg.size());
+}
+
+CLStatus CLFileRW::FWrite(const void *wMsg, size_t len) {
+
+  if (wMsg == 0 || len == 0)
     return CLStatus(-1, 0);
 
+  struct iovec iov = {const_cast<void *>(wMsg), len};
+  return FWrite(&iov, 1);
+}
+
+CLStatus CLFileRW::FWrite(const struct iovec *iov, int iovcnt) {
+
+  if (iov == 0 || iovcnt <= 0)
+    return CLStatus(-1, 0);
+
+  CLStatus s =
+      writer_ ? writer_->Write(iov, iovcnt) : WriteBuffered(iov, iovcnt);
+
+  // 每次提交都要求落盘时，等待本条消息写入文件并落盘后才返回
+  if (s.IsSuccess() && config_.durability == CLDurability::PerCommit)
+    return Sync();
+  return s;
+}
+
+CLStatus CLFileRW::WriteBuffered(const struct iovec *iov, int iovcnt) {
+  // 消息只复制一次，追加到可重复使用的写缓存中；
+  // 写缓存为空时追加的线程负责把缓存写入文件
+  bool leader;
   {
     std::lock_guard<std::mutex> lock(mutex_for_write_);
-    auto temp = std::unique_ptr<char[]>(new char[len_strmsg+1]);
-    memcpy(temp.get(), wMsg, len_strmsg);
-    write_queue_.push(std::move(temp));
+    for (int i = 0; i < iovcnt; ++i) {
+      const char *p = static_cast<const char *>(iov[i].iov_base);
+      write_buffer_.insert(write_buffer_.end(), p, p + iov[i].iov_len);
+    }
+    leader = !flush_pending_;
+    flush_pending_ = true;
   }
 
-  if (write_queue_.size() == 1)
+  if (leader)
     return Flush();
   else {
     return CLStatus(0, 0);
@@ -72,33 +325,49 @@ CLStatus CLFileRW::FWrite(const char *wMsg) {
 }
 
 CLStatus CLFileRW::Flush() {
+  if (writer_)
+    return writer_->Flush();
+
   std::lock_guard<std::mutex> file_lock(mutex_for_use_file_);
 
-  while (!write_queue_.empty()) {
-    int offset = lseek(m_Fd, 0, SEEK_END);
-    const char *buffer = write_queue_.front().get();
-    if (write(m_Fd, buffer, strlen(buffer)) == -1) {
-      return CLStatus(-1, errno);
-    }
-    write_queue_.pop();
+  // 交换两个缓存，写入期间其他线程继续向新的写缓存追加；
+  // 缓存清空后保留容量，稳定后写入路径上不再分配内存
+  {
+    std::lock_guard<std::mutex> lock(mutex_for_write_);
+    write_buffer_.swap(flush_buffer_);
+    flush_pending_ = false;
   }
+  if (flush_buffer_.empty())
+    return CLStatus(0, 0);
 
-  return CLStatus(0, 0);
+  struct iovec iov = {flush_buffer_.data(), flush_buffer_.size()};
+  CLStatus s = WriteVectorLocked(&iov, 1);
+  flush_buffer_.clear();
+  return s;
 }
 
 std::shared_ptr<CLFileRW> CLFileRW::GetInstance() {
   // 只创建一次文件操作对象
-  if (instance_ == nullptr) {
+  if (instance_ptr_.load(std::memory_order_acquire) == nullptr) {
     std::lock_guard<std::mutex> lock(mutex_for_creating_file_);
     if (instance_ == nullptr) {
       instance_ = std::shared_ptr<CLFileRW>(new CLFileRW(),
                                             [](CLFileRW *ptr) { delete ptr; });
+      instance_ptr_.store(instance_.get(), std::memory_order_release);
     }
   }
 
   return instance_;
 }
 
+CLFileRW *CLFileRW::Instance() {
+  // 静态写接口走这里，避免多个线程同时复制 shared_ptr 争用同一个引用计数
+  CLFileRW *pFile = instance_ptr_.load(std::memory_order_acquire);
+  if (pFile != nullptr)
+    return pFile;
+  return GetInstance().get();
+}
+
 CLStatus CLFileRW::FileRead(char *rMsg, int rLength) {
   std::shared_ptr<CLFileRW> pFile = CLFileRW::GetInstance(); // 获取文件操作对象
   if (pFile == 0)
@@ -118,24 +387,96 @@ CLStatus CLFileRW::FileRead(char *rMsg, int rLength) {
     return CLStatus(-1, 0);
 }
 
+CLStatus CLFileRW::FileRead(uint64_t offset, char *rMsg, size_t len) {
+  CLFileRW *pFile = CLFileRW::Instance(); // 获取文件操作对象
+  return pFile->FRead(offset, rMsg, len);
+}
+
 CLStatus CLFileRW::FRead(char *rMsg, int rLength) {
 
-  if (rLength == 0)
+  if (rLength <= 0)
     return CLStatus(0, 0);
 
-  std::lock_guard<std::mutex> read_lock(mutex_for_read_);
-  if (read_buffer_ == nullptr || strlen(read_buffer_.get()) < rLength) {
-    std::lock_guard<std::mutex> file_lock(mutex_for_use_file_);
+  // 从最旧的保留段开始读
+  CLStatus s = FRead(segments_->BeginOffset(), rMsg, rLength);
+  if (s.IsSuccess())
+    return CLStatus(0, 0);
+  else
+    return CLStatus(-1, 0);
+}
+
+CLStatus CLFileRW::FRead(uint64_t offset, char *rMsg, size_t len) {
+
+  // 读到尚未写入文件的部分时，先等待此前提交的消息写入文件
+  if (rMsg != 0 && offset + len > StableEnd())
+    Flush();
+  return FReadWritten(offset, rMsg, len);
+}
+
+CLStatus CLFileRW::FReadWritten(uint64_t offset, char *rMsg, size_t len) {
+
+  if (rMsg == 0)
+    return CLStatus(-1, 0);
+  if (len == 0)
+    return CLStatus(0, 0);
+  if (offset < segments_->BeginOffset())
+    return CLStatus(-1, ERANGE); // 所在的段已被删除
 
-    read_buffer_ = std::unique_ptr<char[]>(new char[4098]);
-    lseek(m_Fd, 0, SEEK_SET);
-    if (read(m_Fd, read_buffer_.get(), rLength) == -1)
-      return CLStatus(-1, 0);
-    std::cout << "read a lot, read from file." << std::endl; // 提示信息
+  // 用 pread 按偏移读取，不使用共享的文件位置，也不与写入者争用锁
+  auto loader = [this](uint64_t off, char *buf, size_t n) {
+    if (merger_)
+      return merger_->Read(off, buf, n);
+    return segments_->ReadAt(off, buf, n);
+  };
+  uint64_t end = StableEnd();
+  if (cache_)
+    return cache_->Read(offset, rMsg, len, end, loader);
+  if (offset >= end)
+    return CLStatus(0, 0);
+  return loader(offset, rMsg, std::min<uint64_t>(len, end - offset));
+}
+
+uint64_t CLFileRW::StableEnd() {
+  // 映射模式下当前段的长度由映射写入后端维护
+  if (config_.mode == CLWriteMode::Mmap)
+    return segments_->ActiveStart() +
+           static_cast<CLMmapWriter *>(writer_.get())->StableEnd();
+  // 分片模式下为按时间戳合并后的稳定部分，先取已写入字节数再取水位
+  if (config_.mode == CLWriteMode::Sharded) {
+    uint64_t written = written_bytes_.load();
+    return merger_->Advance(
+        static_cast<CLShardedWriter *>(writer_.get())->Watermark(), written);
   }
+  return segments_->EndOffset();
+}
 
-  memcpy(rMsg, read_buffer_.get(), rLength);
-  std::cout << "read from buffer." << std::endl; // 提示信息
+CLStatus CLFileRW::WaitReadable(uint64_t offset, int timeout_ms) {
+  auto deadline = std::chrono::steady_clock::now() +
+                  std::chrono::milliseconds(std::max(timeout_ms, 0));
+  std::unique_lock<std::mutex> lock(mutex_for_follow_);
 
-  return CLStatus(0, 0);
+  // 先登记再检查，写入者在更新已写入字节数之后检查登记数，不会漏掉唤醒
+  followers_waiting_.fetch_add(1);
+  uint64_t end;
+  while ((end = StableEnd()) <= offset && !follow_closed_) {
+    if (timeout_ms < 0) {
+      follow_cv_.wait(lock);
+    } else if (follow_cv_.wait_until(lock, deadline) ==
+               std::cv_status::timeout) {
+      end = StableEnd();
+      break;
+    }
+  }
+  followers_waiting_.fetch_sub(1);
+
+  return CLStatus(end, 0);
+}
+
+void CLFileRW::NotifyFollowers() {
+  { std::lock_guard<std::mutex> lock(mutex_for_follow_); }
+  follow_cv_.notify_all();
+}
+
+CLCacheStats CLFileRW::CacheStats() const {
+  return cache_ ? cache_->Stats() : CLCacheStats();
 }
\ No newline at end of file
@@ -1,38 +1,141 @@
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
 #include <memory>
 #include <mutex>
-#include <queue>
+#include <string>
+#include <string_view>
+#include <sys/uio.h>
+#include <thread>
+#include <vector>
 
+#include "CLBlockCache.h"
+#include "CLLogSegments.h"
+#include "CLLogWriter.h"
+#include "CLShardedWriter.h"
 #include "CLStatus.h"
 
+// 写入模式
+enum class CLWriteMode {
+  Sync, // 调用线程直接写入文件
+  Async, // 消息进入无锁环形队列，由后台线程批量写入
+  Staged, // 消息进入线程自己的暂存缓冲区，分组提交写入
+  Mmap,   // 文件按大块预分配并映射，消息直接复制到映射中
+  Sharded // 每个 CPU 写入自己的分片文件，读取时按时间戳合并
+};
+
+// 持久化级别：写接口返回时数据落盘的保证程度
+enum class CLDurability {
+  None,       // 只写入操作系统缓存，不主动落盘
+  IntervalMs, // 后台线程每隔 sync_interval_ms 落盘一次
+  Bytes,      // 未落盘数据累计达到 sync_bytes 时由后台线程落盘
+  PerCommit   // 写接口返回前数据已落盘，并发写入者共享一次 fdatasync
+};
+
+// 文件操作对象的配置，须在第一次 GetInstance 之前通过 Configure 设置
+struct CLFileRWConfig {
+  CLWriteMode mode = CLWriteMode::Sync;
+  size_t ring_capacity = 1 << 20; // 异步模式环形缓冲区的字节数
+  // 异步模式环形缓冲区所在的共享内存名（如 /cllogger）或文件路径，
+  // 进程崩溃后未写出的消息在下次打开时写入日志；为空时在进程内存中。
+  // 其他模式下必须为空
+  std::string ring_path;
+  size_t staging_buffer_size = 64 << 10; // 分组提交模式每个线程的缓冲区字节数
+  unsigned commit_interval_ms = 10;      // 分组提交模式的定时提交间隔
+  size_t mmap_extent_size = 64 << 20;    // 映射模式每次预分配的字节数
+  size_t mmap_max_size = 64ull << 30;    // 映射模式文件的最大字节数
+  size_t shard_count = 0; // 分片模式的分片数，0 表示 CPU 数
+  std::string path;                // 日志文件路径，为空时使用 temp.txt
+  uint64_t rotate_bytes = 0;       // 当前段达到该字节数时轮转，0 表示不轮转
+  unsigned rotate_interval_s = 0;  // 当前段创建后经过该秒数时轮转
+  size_t retention = 0;            // 保留的已轮转段数，0 表示全部保留
+  bool compress_rotated = true;    // 在后台压缩已轮转的段
+  size_t cache_page_size = 64 << 10; // 读缓存的页大小
+  size_t cache_bytes = 64 << 20;     // 读缓存的总字节数，0 表示不缓存
+  size_t readahead_pages = 8;        // 顺序读时一次读入的页数
+  CLDurability durability = CLDurability::None;
+  unsigned sync_interval_ms = 100; // IntervalMs 级别的落盘间隔
+  size_t sync_bytes = 1 << 20;     // Bytes 级别的落盘阈值
+};
+
 class CLFileRW {
 public:
+  static CLStatus Configure(const CLFileRWConfig &config); // 设置配置
   static std::shared_ptr<CLFileRW> GetInstance();    // 获取文件操作对象
   static CLStatus FileWrite(const char *wMsg);       // 文件的写操作
+  static CLStatus FileWrite(const void *wMsg, size_t len);
   static CLStatus FileRead(char *rMsg, int rLength); // 文件的读操作
+  static CLStatus FileRead(uint64_t offset, char *rMsg, size_t len);
 
-  CLStatus FWrite(const char *wMsg);
-  CLStatus FRead(char *rMsg, int rLength);
-  CLStatus Flush(); // 写入写缓存到文件中
+  CLStatus FWrite(const char *wMsg); // 写入以 '\0' 结尾的字符串
+  CLStatus FWrite(const void *wMsg, size_t len); // 写入任意字节，可包含 '\0'
+  CLStatus FWrite(std::string_view wMsg);
+  CLStatus FWrite(const struct iovec *iov, int iovcnt); // 多段拼接为一条消息
+  CLStatus FRead(char *rMsg, int rLength); // 从日志开头读取
+  // 从日志偏移 offset 处读取，返回值的 ReturnCode 为读取的字节数
+  CLStatus FRead(uint64_t offset, char *rMsg, size_t len);
+  // 只读取已写入文件的部分，不写出写缓存
+  CLStatus FReadWritten(uint64_t offset, char *rMsg, size_t len);
+  // 等待日志长度超过 offset，timeout_ms 为负时一直等待；
+  // 返回值的 ReturnCode 为此时已写入文件的日志长度，Shutdown 后立即返回
+  CLStatus WaitReadable(uint64_t offset, int timeout_ms);
+  CLCacheStats CacheStats() const; // 读缓存的命中统计
+  CLStatus Flush();    // 写入写缓存到文件中
+  CLStatus Sync();     // 写入写缓存并等待此前写入的数据全部落盘
+  CLStatus Shutdown(); // 写完所有缓存的消息并停止后台线程
 
 private:
+  friend class CLBinaryLog; // 写入时检查当前段是否已轮转
+
   CLFileRW();
   CLFileRW(const CLFileRW &) = delete;
   CLFileRW &operator=(const CLFileRW &) = delete;
   ~CLFileRW();
 
-  int m_Fd;                            // 文件标识符
+  static CLFileRW *Instance(); // 获取文件操作对象，不增加引用计数
+
+  CLStatus WriteBuffered(const struct iovec *iov, int iovcnt); // 同步模式写入
+
+  CLStatus WriteVector(const struct iovec *iov, int iovcnt); // 完整写入一组缓冲区
+  CLStatus WriteVectorLocked(const struct iovec *iov, int iovcnt); // 已持有文件锁
+  void NoteWritten(uint64_t n);     // 记录写入文件的字节数
+  uint64_t StableEnd(); // 已写入文件且内容不再变化的日志长度
+  void NotifyFollowers(); // 唤醒等待新数据的读者
+  CLStatus SyncTo(uint64_t target); // 等待前 target 字节落盘
+  void SyncLoop();                  // 后台落盘线程
+
+  std::unique_ptr<CLLogSegments> segments_; // 分段的日志文件
   pthread_mutex_t *m_pMutexForUseFile; // 文件使用互斥量
 
-  std::queue<std::unique_ptr<char[]>> write_queue_; // 写队列
-  std::unique_ptr<char[]> read_buffer_;  // 读缓存
+  std::vector<char> write_buffer_; // 写缓存，新消息追加到末尾
+  std::vector<char> flush_buffer_; // 正在写入文件的缓存，与写缓存交换使用
+  bool flush_pending_ = false;     // 写缓存中的消息是否已有线程负责写入
+  std::unique_ptr<CLBlockCache> cache_;  // 读缓存
+  std::unique_ptr<CLLogWriter> writer_;  // 非同步模式下的写入后端
+  std::unique_ptr<CLShardMerger> merger_; // 分片模式下合并各分片供读取
+
+  std::atomic<uint64_t> written_bytes_{0}; // 已写入文件的字节数
+  std::atomic<uint64_t> synced_bytes_{0}; // 已落盘的字节数
+  bool syncing_ = false;        // 是否有线程正在执行 fdatasync
+  bool sync_stop_ = false;      // 通知后台落盘线程退出
+  std::mutex mutex_for_sync_;   // 保护以上落盘状态
+  std::condition_variable sync_cv_;   // 通知等待落盘的线程
+  std::condition_variable syncer_cv_; // 唤醒后台落盘线程
+  std::thread syncer_;                // 后台落盘线程
+
+  std::atomic<int> followers_waiting_{0}; // 正在等待新数据的读者数
+  bool follow_closed_ = false;            // 已关闭，读者不再等待
+  std::mutex mutex_for_follow_;           // 保护 follow_closed_
+  std::condition_variable follow_cv_;     // 通知等待新数据的读者
 
   static std::shared_ptr<CLFileRW> instance_; // 文件操作对象的实例
+  static std::atomic<CLFileRW *> instance_ptr_; // 实例创建完成后发布的指针
   static std::mutex mutex_for_creating_file_; // 创建文件互斥量
   static std::mutex mutex_for_write_;         // 使用文件互斥量
-  static std::mutex mutex_for_read_;          // 读互斥量
   static std::mutex mutex_for_use_file_;      // 使用文件互斥量
+  static CLFileRWConfig config_;              // 文件操作对象的配置
 
   static const std::string LOG_FILE_NAME_; // 文件名
   static const int BUFFER_SIZE_;           // 缓存大小
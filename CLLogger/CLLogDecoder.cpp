@@ -0,0 +1,387 @@
+#include "CLLogDecoder.h"
+
+#include <cinttypes>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <time.h>
+#include <vector>
+
+#include "CLBinaryLog.h"
+
+const uint32_t CLLogDecoder::MAX_PAYLOAD_ = 64 << 20;
+const size_t CLLogDecoder::MAX_HELD_ = 1 << 16;
+
+namespace {
+
+// 一个解码后的参数
+struct Arg {
+  char type;
+  uint64_t bits; // 整数、指针或 double 的二进制表示
+  std::string str;
+
+  int64_t AsInt() const {
+    if (type == CLBinaryFormat::ARG_DOUBLE) {
+      double d;
+      memcpy(&d, &bits, sizeof(d));
+      return static_cast<int64_t>(d);
+    }
+    return static_cast<int64_t>(bits);
+  }
+
+  double AsDouble() const {
+    if (type == CLBinaryFormat::ARG_DOUBLE) {
+      double d;
+      memcpy(&d, &bits, sizeof(d));
+      return d;
+    }
+    if (type == CLBinaryFormat::ARG_INT)
+      return static_cast<double>(static_cast<int64_t>(bits));
+    return static_cast<double>(bits);
+  }
+};
+
+template <typename T> bool Get(const char *&p, const char *end, T &value) {
+  if (end - p < (ptrdiff_t)sizeof(value))
+    return false;
+  memcpy(&value, p, sizeof(value));
+  p += sizeof(value);
+  return true;
+}
+
+bool GetString(const char *&p, const char *end, std::string &s) {
+  uint32_t len;
+  if (!Get(p, end, len) || end - p < (ptrdiff_t)len)
+    return false;
+  s.assign(p, len);
+  p += len;
+  return true;
+}
+
+__attribute__((format(printf, 2, 3))) void Append(std::string &out,
+                                                  const char *fmt, ...) {
+  char buf[256];
+  va_list ap;
+  va_start(ap, fmt);
+  int n = vsnprintf(buf, sizeof(buf), fmt, ap);
+  va_end(ap);
+  if (n < 0)
+    return;
+  if ((size_t)n < sizeof(buf)) {
+    out.append(buf, n);
+    return;
+  }
+
+  std::vector<char> big(n + 1);
+  va_start(ap, fmt);
+  vsnprintf(big.data(), big.size(), fmt, ap);
+  va_end(ap);
+  out.append(big.data(), n);
+}
+
+// 解析条目记录的负载，p 之后为参数
+bool ParseEntry(const char *p, const char *end, uint32_t &id, uint64_t &ts,
+                std::vector<Arg> &args) {
+  if (!Get(p, end, id) || !Get(p, end, ts))
+    return false;
+
+  while (p < end) {
+    Arg arg;
+    arg.type = *p++;
+    arg.bits = 0;
+    bool ok;
+    if (arg.type == CLBinaryFormat::ARG_STRING)
+      ok = GetString(p, end, arg.str);
+    else if (arg.type == CLBinaryFormat::ARG_INT ||
+             arg.type == CLBinaryFormat::ARG_UINT ||
+             arg.type == CLBinaryFormat::ARG_DOUBLE ||
+             arg.type == CLBinaryFormat::ARG_POINTER)
+      ok = Get(p, end, arg.bits);
+    else
+      ok = false;
+    if (!ok)
+      return false;
+    args.push_back(arg);
+  }
+  return true;
+}
+
+// 按 printf 格式串格式化，参数按类型字节转换为转换说明需要的类型
+void Format(const std::string &fmt, const std::vector<Arg> &args,
+            std::string &out) {
+  size_t next = 0;
+  const char *p = fmt.c_str();
+  while (*p) {
+    const char *percent = strchr(p, '%');
+    if (percent == nullptr) {
+      out.append(p);
+      break;
+    }
+    out.append(p, percent - p);
+    p = percent + 1;
+    if (*p == '%') {
+      out.push_back('%');
+      ++p;
+      continue;
+    }
+
+    // 标志、宽度与精度原样保留，'*' 替换为对应参数的值；长度修饰符去掉
+    std::string spec = "%";
+    while (*p && strchr("-+ #0'", *p))
+      spec.push_back(*p++);
+    for (int field = 0; field < 2; ++field) {
+      if (field == 1) {
+        if (*p != '.')
+          break;
+        spec.push_back(*p++);
+      }
+      if (*p == '*') {
+        ++p;
+        spec += std::to_string(next < args.size() ? args[next++].AsInt() : 0);
+      }
+      while (*p >= '0' && *p <= '9')
+        spec.push_back(*p++);
+    }
+    while (*p && strchr("hlLqjzt", *p))
+      ++p;
+    char conv = *p;
+    if (conv == 0)
+      break;
+    ++p;
+
+    if (next >= args.size()) {
+      // 参数不足，保留转换说明
+      out += spec;
+      out.push_back(conv);
+      continue;
+    }
+    const Arg &arg = args[next++];
+    switch (conv) {
+    case 'd':
+    case 'i':
+      Append(out, (spec + "lld").c_str(), (long long)arg.AsInt());
+      break;
+    case 'u':
+    case 'o':
+    case 'x':
+    case 'X':
+      Append(out, (spec + "ll" + conv).c_str(),
+             (unsigned long long)arg.AsInt());
+      break;
+    case 'c':
+      Append(out, (spec + "c").c_str(), (int)arg.AsInt());
+      break;
+    case 'f':
+    case 'F':
+    case 'e':
+    case 'E':
+    case 'g':
+    case 'G':
+    case 'a':
+    case 'A':
+      Append(out, (spec + conv).c_str(), arg.AsDouble());
+      break;
+    case 's':
+      if (arg.type == CLBinaryFormat::ARG_STRING)
+        Append(out, (spec + "s").c_str(), arg.str.c_str());
+      else
+        Append(out, (spec + "s").c_str(), "(?)");
+      break;
+    case 'p':
+      Append(out, (spec + "p").c_str(), (void *)(uintptr_t)arg.bits);
+      break;
+    default:
+      // %n 等不支持的转换只消耗参数
+      break;
+    }
+  }
+}
+
+} // namespace
+
+CLLogDecoder::CLLogDecoder() : has_clock_(false), clock_offset_(0) {}
+
+void CLLogDecoder::Feed(const char *data, size_t len, std::string &out) {
+  if (pending_.empty()) {
+    size_t used = Decode(data, len, false, out);
+    pending_.assign(data + used, len - used);
+    return;
+  }
+
+  pending_.append(data, len);
+  size_t used = Decode(pending_.data(), pending_.size(), false, out);
+  pending_.erase(0, used);
+}
+
+void CLLogDecoder::Finish(std::string &out) {
+  Decode(pending_.data(), pending_.size(), true, out);
+  pending_.clear();
+
+  // 始终没有读到字典或时钟记录的条目
+  for (const std::string &entry : held_)
+    FormatEntry(entry, true, out);
+  held_.clear();
+}
+
+size_t CLLogDecoder::Decode(const char *p, size_t len, bool final,
+                            std::string &out) {
+  const char *begin = p;
+  const char *end = p + len;
+  while (p < end) {
+    // 文本部分原样输出，直到可能的记录开头
+    const char *zero =
+        static_cast<const char *>(memchr(p, CLBinaryFormat::MAGIC0, end - p));
+    if (zero == nullptr) {
+      out.append(p, end - p);
+      return len;
+    }
+    out.append(p, zero - p);
+    p = zero;
+
+    size_t avail = end - p;
+    if (avail < CLBinaryFormat::HEADER_SIZE) {
+      if (!final && (avail < 2 || (unsigned char)p[1] == CLBinaryFormat::MAGIC1))
+        break;
+      out.push_back(*p++);
+      continue;
+    }
+
+    uint32_t payload;
+    memcpy(&payload, p + 3, sizeof(payload));
+    unsigned char type = p[2];
+    bool header_ok = (unsigned char)p[1] == CLBinaryFormat::MAGIC1 &&
+                     (type == CLBinaryFormat::DICT ||
+                      type == CLBinaryFormat::ENTRY ||
+                      type == CLBinaryFormat::CLOCK) &&
+                     payload <= MAX_PAYLOAD_;
+    if (!header_ok) {
+      out.push_back(*p++);
+      continue;
+    }
+
+    size_t total = CLBinaryFormat::HEADER_SIZE + payload + 1;
+    if (avail < total) {
+      if (!final)
+        break;
+      out.push_back(*p++);
+      continue;
+    }
+
+    const char *body = p + CLBinaryFormat::HEADER_SIZE;
+    bool ok = (unsigned char)body[payload] == CLBinaryFormat::TRAILER;
+    if (ok && type == CLBinaryFormat::DICT)
+      ok = DecodeDict(body, payload, out);
+    else if (ok && type == CLBinaryFormat::CLOCK)
+      ok = DecodeClock(body, payload, out);
+    else if (ok)
+      ok = DecodeEntry(body, payload, out);
+    if (!ok) {
+      // 不是有效的记录，当作普通字节
+      out.push_back(*p++);
+      continue;
+    }
+    p += total;
+  }
+  return p - begin;
+}
+
+bool CLLogDecoder::DecodeDict(const char *p, size_t len, std::string &out) {
+  const char *end = p + len;
+  uint32_t id;
+  Site site;
+  if (!Get(p, end, id) || !Get(p, end, site.line) ||
+      !Get(p, end, site.level) || !GetString(p, end, site.file) ||
+      !GetString(p, end, site.fmt) || p != end)
+    return false;
+  // 进程重启后编号重新分配，以最近的字典记录为准
+  sites_[id] = site;
+  ReleaseHeld(out);
+  return true;
+}
+
+bool CLLogDecoder::DecodeClock(const char *p, size_t len, std::string &out) {
+  const char *end = p + len;
+  uint64_t mono, real;
+  if (!Get(p, end, mono) || !Get(p, end, real) || p != end)
+    return false;
+  clock_offset_ = static_cast<int64_t>(real - mono);
+  has_clock_ = true;
+  ReleaseHeld(out);
+  return true;
+}
+
+bool CLLogDecoder::DecodeEntry(const char *p, size_t len, std::string &out) {
+  uint32_t id;
+  uint64_t ts;
+  std::vector<Arg> args;
+  if (!ParseEntry(p, p + len, id, ts, args))
+    return false;
+
+  std::string entry(p, len);
+  if (!held_.empty() || !FormatEntry(entry, false, out)) {
+    // 保持输出顺序：已有保留的条目时新条目也排在其后
+    held_.push_back(entry);
+    if (held_.size() > MAX_HELD_) {
+      FormatEntry(held_.front(), true, out);
+      held_.pop_front();
+      ReleaseHeld(out);
+    }
+  }
+  return true;
+}
+
+void CLLogDecoder::ReleaseHeld(std::string &out) {
+  while (!held_.empty() && FormatEntry(held_.front(), false, out))
+    held_.pop_front();
+}
+
+bool CLLogDecoder::FormatEntry(const std::string &entry, bool force,
+                               std::string &out) {
+  uint32_t id;
+  uint64_t ts;
+  std::vector<Arg> args;
+  ParseEntry(entry.data(), entry.data() + entry.size(), id, ts, args);
+
+  auto it = sites_.find(id);
+  const Site *site = it == sites_.end() ? nullptr : &it->second;
+  if (!force && (site == nullptr || !has_clock_))
+    return false;
+
+  char stamp[64];
+  if (has_clock_) {
+    uint64_t real = ts + clock_offset_;
+    struct tm tm;
+    time_t sec = real / 1000000000;
+    localtime_r(&sec, &tm);
+    size_t n = strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", &tm);
+    snprintf(stamp + n, sizeof(stamp) - n, ".%09" PRIu64,
+             real % 1000000000);
+  } else {
+    // 没有时钟记录，只能输出单调时钟
+    snprintf(stamp, sizeof(stamp), "+%" PRIu64 ".%09" PRIu64,
+             ts / 1000000000, ts % 1000000000);
+  }
+  out += stamp;
+
+  if (site == nullptr) {
+    // 字典记录所在的段已被删除或不在输入中
+    Append(out, " ? <unknown site %" PRIu32 ">", id);
+    for (const Arg &arg : args) {
+      if (arg.type == CLBinaryFormat::ARG_STRING)
+        Append(out, " \"%s\"", arg.str.c_str());
+      else
+        Append(out, " %lld", (long long)arg.AsInt());
+    }
+  } else {
+    const char *file = strrchr(site->file.c_str(), '/');
+    file = file ? file + 1 : site->file.c_str();
+    Append(out, " %-5s %s:%" PRIu32 " ",
+           CLLogLevelName(static_cast<CLLogLevel>(site->level)), file,
+           site->line);
+    Format(site->fmt, args, out);
+  }
+
+  if (out.back() != '\n')
+    out.push_back('\n');
+  return true;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <unordered_map>
+
+#include "CLStatus.h"
+
+// 把含有结构化二进制记录（见 CLBinaryLog.h）的日志还原为文本：
+// 字典记录只用于登记调用点，条目记录按格式串格式化为一行，
+// 其余字节按原样输出。日志可以分多次输入，跨越输入边界的记录会被保留。
+// 暂存或异步模式下条目可能先于其字典记录或时钟记录写入，这样的条目
+// 暂时保留，读到所需的记录后再按原顺序输出
+class CLLogDecoder {
+public:
+  CLLogDecoder();
+
+  // 解码 data 中的字节，得到的文本追加到 out
+  void Feed(const char *data, size_t len, std::string &out);
+  // 输入结束，残留的不完整记录按原样输出
+  void Finish(std::string &out);
+
+private:
+  CLLogDecoder(const CLLogDecoder &) = delete;
+  CLLogDecoder &operator=(const CLLogDecoder &) = delete;
+
+  // 调用点信息
+  struct Site {
+    std::string file;
+    uint32_t line;
+    uint32_t level;
+    std::string fmt;
+  };
+
+  // 解码 [p, p + len) 中的完整记录与文本，返回已处理的字节数；
+  // final 为 false 时末尾不完整的记录留待下次
+  size_t Decode(const char *p, size_t len, bool final, std::string &out);
+  bool DecodeDict(const char *p, size_t len, std::string &out);
+  bool DecodeClock(const char *p, size_t len, std::string &out);
+  bool DecodeEntry(const char *p, size_t len, std::string &out);
+  // 格式化一条已校验的条目记录，force 为 false 且缺少字典或时钟时返回 false
+  bool FormatEntry(const std::string &entry, bool force, std::string &out);
+  void ReleaseHeld(std::string &out); // 输出已可以格式化的保留条目
+
+  std::unordered_map<uint32_t, Site> sites_;
+  std::string pending_; // 上次输入末尾不完整的记录
+  bool has_clock_;
+  int64_t clock_offset_; // 实时时钟减单调时钟（纳秒）
+  std::deque<std::string> held_; // 等待字典或时钟记录的条目，按读入顺序
+
+  static const size_t MAX_HELD_;      // 保留的条目超过该数量时直接输出
+
+  static const uint32_t MAX_PAYLOAD_; // 超过该长度的负载视为普通字节
+};
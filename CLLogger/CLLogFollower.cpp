@@ -0,0 +1,277 @@
+#include "CLLogFollower.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <libgen.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+#include <zlib.h>
+
+#include "CLFileRW.h"
+
+CLLogFollower::CLLogFollower(uint64_t offset)
+    : offset_(offset), file_(nullptr), seq_(0), active_(false), fd_(-1),
+      gz_(nullptr), file_offset_(0), prev_fd_(-1), prev_offset_(0),
+      inotify_fd_(-1) {}
+
+CLLogFollower::CLLogFollower(const std::string &path, uint64_t offset)
+    : path_(path), offset_(offset), file_(nullptr), seq_(0), active_(false),
+      fd_(-1), gz_(nullptr), file_offset_(offset), prev_fd_(-1),
+      prev_offset_(0), inotify_fd_(-1) {}
+
+CLLogFollower::~CLLogFollower() {
+  CloseCurrent();
+  if (prev_fd_ != -1)
+    close(prev_fd_);
+  if (inotify_fd_ != -1)
+    close(inotify_fd_);
+}
+
+void CLLogFollower::CloseCurrent() {
+  if (fd_ != -1)
+    close(fd_);
+  if (gz_ != nullptr)
+    gzclose(gz_);
+  fd_ = -1;
+  gz_ = nullptr;
+}
+
+CLStatus CLLogFollower::Open() {
+  if (path_.empty()) {
+    file_ = CLFileRW::GetInstance().get(); // 单例在进程退出前一直存在
+    return CLStatus(0, 0);
+  }
+
+  inotify_fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (inotify_fd_ == -1)
+    return CLStatus(-1, errno);
+
+  // 监视所在目录：文件的修改、改名与新建都会产生事件
+  std::vector<char> dir(path_.begin(), path_.end());
+  dir.push_back('\0');
+  if (inotify_add_watch(inotify_fd_, dirname(dir.data()),
+                        IN_MODIFY | IN_CREATE | IN_MOVED_FROM | IN_MOVED_TO |
+                            IN_DELETE) == -1)
+    return CLStatus(-1, errno);
+
+  fd_ = open(path_.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd_ == -1)
+    return CLStatus(-1, errno);
+  active_ = true;
+  seq_ = MaxSeq() + 1;
+  return CLStatus(0, 0);
+}
+
+uint64_t CLLogFollower::MaxSeq() {
+  std::vector<char> copy(path_.begin(), path_.end());
+  copy.push_back('\0');
+  std::string base = basename(copy.data());
+  copy.assign(path_.begin(), path_.end());
+  copy.push_back('\0');
+  DIR *dir = opendir(dirname(copy.data()));
+  if (dir == nullptr)
+    return 0;
+
+  // 段名为 base.N 或 base.N.gz
+  uint64_t max = 0;
+  struct dirent *entry;
+  while ((entry = readdir(dir)) != nullptr) {
+    const char *name = entry->d_name;
+    if (strncmp(name, base.c_str(), base.size()) != 0 || name[base.size()] != '.')
+      continue;
+    const char *digits = name + base.size() + 1;
+    char *end;
+    uint64_t seq = strtoull(digits, &end, 10);
+    if (end == digits || (*end != '\0' && strcmp(end, ".gz") != 0))
+      continue;
+    max = std::max(max, seq);
+  }
+  closedir(dir);
+  return max;
+}
+
+CLStatus CLLogFollower::Read(char *buf, size_t len, int timeout_ms) {
+  if (buf == nullptr)
+    return CLStatus(-1, EINVAL);
+  if (len == 0)
+    return CLStatus(0, 0);
+  if (path_.empty()) {
+    if (file_ == nullptr)
+      return CLStatus(-1, EBADF);
+    return ReadLocal(buf, len, timeout_ms);
+  }
+  if (fd_ == -1 && gz_ == nullptr)
+    return CLStatus(-1, EBADF);
+  return ReadFile(buf, len, timeout_ms);
+}
+
+CLStatus CLLogFollower::ReadLocal(char *buf, size_t len, int timeout_ms) {
+  auto deadline = std::chrono::steady_clock::now() +
+                  std::chrono::milliseconds(std::max(timeout_ms, 0));
+  while (true) {
+    // 只读已写入文件的部分，读者不会触发写缓存的写出
+    CLStatus s = file_->FReadWritten(offset_, buf, len);
+    if (!s.IsSuccess() || s.ReturnCode() > 0) {
+      if (s.IsSuccess())
+        offset_ += s.ReturnCode();
+      return s;
+    }
+
+    int remaining = -1;
+    if (timeout_ms >= 0) {
+      auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+          deadline - std::chrono::steady_clock::now());
+      if (left.count() <= 0)
+        return CLStatus(0, 0);
+      remaining = left.count();
+    }
+    s = file_->WaitReadable(offset_, remaining);
+    if ((uint64_t)s.ReturnCode() <= offset_)
+      return CLStatus(0, 0); // 超时或日志已关闭
+  }
+}
+
+ssize_t CLLogFollower::ReadCurrent(char *buf, size_t len) {
+  ssize_t n;
+  if (gz_ != nullptr) {
+    n = gzread(gz_, buf, len);
+    if (n < 0)
+      errno = EIO;
+  } else {
+    do
+      n = pread(fd_, buf, len, file_offset_);
+    while (n == -1 && errno == EINTR);
+  }
+  if (n > 0)
+    file_offset_ += n;
+  return n;
+}
+
+CLStatus CLLogFollower::CheckRotated() {
+  struct stat now, cur;
+  if (fstat(fd_, &cur) == -1)
+    return CLStatus(-1, errno);
+  if (stat(path_.c_str(), &now) == 0 && now.st_ino == cur.st_ino &&
+      now.st_dev == cur.st_dev)
+    return CLStatus(0, 0);
+
+  // 已改名为 path.N：打开时推算的序号可能因同时发生的轮转而偏小，按 inode 校正
+  for (uint64_t seq = seq_; seq <= seq_ + 16; ++seq) {
+    struct stat st;
+    std::string name = path_ + "." + std::to_string(seq);
+    if (stat(name.c_str(), &st) == 0 && st.st_ino == cur.st_ino &&
+        st.st_dev == cur.st_dev) {
+      seq_ = seq;
+      break;
+    }
+  }
+  return CLStatus(1, 0);
+}
+
+CLStatus CLLogFollower::OpenNext() {
+  uint64_t next = seq_ + 1;
+  std::string name = path_ + "." + std::to_string(next);
+
+  int fd = open(name.c_str(), O_RDONLY | O_CLOEXEC);
+  gzFile gz = nullptr;
+  bool active = false;
+  if (fd == -1) {
+    // 落后较多时下一个段可能已压缩
+    gz = gzopen((name + ".gz").c_str(), "rb");
+    if (gz == nullptr) {
+      fd = open(path_.c_str(), O_RDONLY | O_CLOEXEC);
+      if (fd == -1)
+        return errno == ENOENT ? CLStatus(0, 0) : CLStatus(-1, errno);
+      active = true;
+    }
+  }
+
+  // 未压缩的旧段保留到新段有内容为止，期间写入旧段的内容仍能读到
+  if (fd_ != -1) {
+    if (prev_fd_ != -1)
+      close(prev_fd_);
+    prev_fd_ = fd_;
+    prev_offset_ = file_offset_;
+    fd_ = -1;
+  }
+  CloseCurrent();
+
+  fd_ = fd;
+  gz_ = gz;
+  active_ = active;
+  seq_ = next;
+  file_offset_ = 0;
+  return CLStatus(1, 0);
+}
+
+CLStatus CLLogFollower::ReadFile(char *buf, size_t len, int timeout_ms) {
+  auto deadline = std::chrono::steady_clock::now() +
+                  std::chrono::milliseconds(std::max(timeout_ms, 0));
+  while (true) {
+    // 轮转时改名在前，替换写入者使用的文件在后，期间的写入仍落在旧段中
+    if (prev_fd_ != -1) {
+      ssize_t n = pread(prev_fd_, buf, len, prev_offset_);
+      if (n > 0) {
+        prev_offset_ += n;
+        offset_ += n;
+        return CLStatus(n, 0);
+      }
+      if (file_offset_ > 0) {
+        // 新段已有内容，旧段不会再有写入
+        close(prev_fd_);
+        prev_fd_ = -1;
+      }
+    }
+
+    ssize_t n = ReadCurrent(buf, len);
+    if (n == -1)
+      return CLStatus(-1, errno);
+    if (n > 0) {
+      offset_ += n;
+      return CLStatus(n, 0);
+    }
+
+    // 读到段末尾：已轮转的段读完后继续读下一个段
+    CLStatus s(0, 0);
+    if (!active_) {
+      s = OpenNext();
+    } else {
+      s = CheckRotated();
+      if (s.IsSuccess() && s.ReturnCode() == 1)
+        s = OpenNext();
+    }
+    if (!s.IsSuccess())
+      return s;
+    if (s.ReturnCode() == 1)
+      continue;
+
+    int remaining = -1;
+    if (timeout_ms >= 0) {
+      auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+          deadline - std::chrono::steady_clock::now());
+      if (left.count() <= 0)
+        return CLStatus(0, 0);
+      remaining = left.count();
+    }
+
+    struct pollfd pfd = {inotify_fd_, POLLIN, 0};
+    int r = poll(&pfd, 1, remaining);
+    if (r == -1 && errno != EINTR)
+      return CLStatus(-1, errno);
+    if (r == 0)
+      return CLStatus(0, 0);
+
+    // 事件只用于唤醒，读完后重新检查文件
+    char events[4096];
+    while (read(inotify_fd_, events, sizeof(events)) > 0) {
+    }
+  }
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <sys/types.h>
+
+#include "CLStatus.h"
+
+class CLFileRW;
+
+// 跟随读取日志的新内容（类似 tail -F）。每个读者保存自己的读取位置，
+// 写入路径上只在有读者等待时才发出一次唤醒，读者数量不影响写入开销。
+// 本进程的日志通过 CLFileRW 的通知等待新数据，可跨越轮转的段；
+// 其他进程写入的日志通过 inotify 等待，轮转后依次读取 path.N、path.N+1……
+// 直到当前段，落后时已压缩的段按 gzip 读取。
+// inotify 方式不支持其他进程以映射模式写入（文件末尾为预分配的零字节）
+class CLLogFollower {
+public:
+  // 跟随本进程 CLFileRW 写入的日志，从日志偏移 offset 开始
+  explicit CLLogFollower(uint64_t offset);
+  // 跟随其他进程写入的日志文件 path，从当前段的文件偏移 offset 开始
+  CLLogFollower(const std::string &path, uint64_t offset);
+  ~CLLogFollower();
+
+  CLStatus Open(); // 读取前调用
+
+  // 读取新内容，没有新内容时最多等待 timeout_ms 毫秒（为负时一直等待）；
+  // 返回值的 ReturnCode 为读取的字节数，0 表示超时或日志已关闭
+  CLStatus Read(char *buf, size_t len, int timeout_ms);
+
+  // 本进程方式下为下一次读取的日志偏移，inotify 方式下为起始偏移加已读取的字节数
+  uint64_t Offset() const { return offset_; }
+
+private:
+  CLLogFollower(const CLLogFollower &) = delete;
+  CLLogFollower &operator=(const CLLogFollower &) = delete;
+
+  CLStatus ReadLocal(char *buf, size_t len, int timeout_ms);
+  CLStatus ReadFile(char *buf, size_t len, int timeout_ms);
+  ssize_t ReadCurrent(char *buf, size_t len); // 从当前段读取
+  CLStatus CheckRotated(); // 当前段已被轮转时 ReturnCode 为 1
+  CLStatus OpenNext();     // 打开下一个段，尚未创建时 ReturnCode 为 0
+  uint64_t MaxSeq();       // 目录中已轮转的段的最大序号
+  void CloseCurrent();
+
+  std::string path_;      // 为空时跟随本进程的日志
+  uint64_t offset_;
+  CLFileRW *file_;        // 本进程的文件操作对象
+
+  // 以下用于 inotify 方式
+  uint64_t seq_;          // 当前段的序号，当前段为 path 时为其轮转后的序号
+  bool active_;           // 当前段是否为 path
+  int fd_;                // 当前段，未压缩时使用
+  struct gzFile_s *gz_;   // 当前段，已压缩时使用
+  uint64_t file_offset_;  // 当前段内的偏移
+  int prev_fd_;           // 轮转前的段，可能仍有写入者在写
+  uint64_t prev_offset_;
+  int inotify_fd_;
+};
@@ -0,0 +1,22 @@
+#include "CLLogLevel.h"
+
+std::atomic<int> CLLogThreshold::level_(static_cast<int>(CLLogLevel::Info));
+
+const char *CLLogLevelName(CLLogLevel level) {
+  switch (level) {
+  case CLLogLevel::Trace:
+    return "TRACE";
+  case CLLogLevel::Debug:
+    return "DEBUG";
+  case CLLogLevel::Info:
+    return "INFO";
+  case CLLogLevel::Warn:
+    return "WARN";
+  case CLLogLevel::Error:
+    return "ERROR";
+  case CLLogLevel::Fatal:
+    return "FATAL";
+  default:
+    return "OFF";
+  }
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <atomic>
+
+// 日志级别，由低到高
+enum class CLLogLevel : int { Trace, Debug, Info, Warn, Error, Fatal, Off };
+
+// 编译期最低级别（CLLogLevel 的数值），低于它的 CL_LOG 在编译时被整体去掉
+#ifndef CL_LOG_MIN_LEVEL
+#define CL_LOG_MIN_LEVEL 0
+#endif
+
+constexpr CLLogLevel CL_LOG_COMPILED_MIN =
+    static_cast<CLLogLevel>(CL_LOG_MIN_LEVEL);
+
+const char *CLLogLevelName(CLLogLevel level);
+
+// 运行期最低级别，只对编译期保留的调用生效，检查只需一次原子读
+class CLLogThreshold {
+public:
+  static void Set(CLLogLevel level) {
+    level_.store(static_cast<int>(level), std::memory_order_relaxed);
+  }
+  static CLLogLevel Get() {
+    return static_cast<CLLogLevel>(level_.load(std::memory_order_relaxed));
+  }
+  static bool Enabled(CLLogLevel level) {
+    return __builtin_expect(
+        static_cast<int>(level) >= level_.load(std::memory_order_relaxed), 1);
+  }
+
+private:
+  static std::atomic<int> level_;
+};
@@ -0,0 +1,570 @@
+#include "CLLogSegments.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include "CLMmapWriter.h"
+
+CLLogFile::~CLLogFile() { close(fd); }
+
+// gzip 扩展字段中记录未压缩长度的子字段：标识 "CL"，8 字节小端整数
+static const unsigned char SIZE_FIELD_ID[2] = {'C', 'L'};
+static const size_t SIZE_FIELD_LEN = 8;
+
+CLLogSegments::CLLogSegments(const std::string &path, uint64_t rotate_bytes,
+                             unsigned rotate_interval_s, size_t retention,
+                             bool compress)
+    : path_(path), rotate_bytes_(rotate_bytes),
+      rotate_interval_s_(rotate_interval_s), retention_(retention),
+      compress_(compress), current_(nullptr), generation_(0), next_seq_(1),
+      rotate_requested_(false), stop_(false) {}
+
+CLLogSegments::~CLLogSegments() { Close(); }
+
+std::string CLLogSegments::SegmentPath(uint64_t seq) const {
+  return path_ + "." + std::to_string(seq);
+}
+
+CLStatus CLLogSegments::Open() {
+  CLStatus s = LoadSegments();
+  if (!s.IsSuccess())
+    return s;
+
+  int fd = open(path_.c_str(), O_RDWR | O_CREAT | O_APPEND, S_IRUSR | S_IWUSR);
+  if (fd == -1)
+    return CLStatus(-1, errno);
+
+  // 上次以映射模式运行时崩溃，文件末尾会留下预分配的零字节；
+  // 只有留下了标记文件时才去掉，其他模式写入的零字节原样保留
+  s = CLMmapWriter::Recover(fd, CLMmapWriter::MarkerPath(path_));
+  if (!s.IsSuccess()) {
+    close(fd);
+    return s;
+  }
+
+  uint64_t start = segments_.empty()
+                       ? 0
+                       : segments_.back().start + segments_.back().size;
+  active_ = std::make_shared<CLLogFile>(fd, start, s.ReturnCode());
+  current_.store(active_.get());
+  opened_at_ = std::chrono::steady_clock::now();
+
+  if (rotate_bytes_ != 0 || rotate_interval_s_ != 0)
+    maintenance_ = std::thread(&CLLogSegments::MaintenanceLoop, this);
+  if (compress_ && (maintenance_.joinable() || !compress_queue_.empty()))
+    compressor_ = std::thread(&CLLogSegments::CompressLoop, this);
+
+  return CLStatus(0, 0);
+}
+
+CLStatus CLLogSegments::LoadSegments() {
+  std::string dir = ".";
+  std::string base = path_;
+  size_t slash = path_.rfind('/');
+  if (slash != std::string::npos) {
+    dir = slash == 0 ? "/" : path_.substr(0, slash);
+    base = path_.substr(slash + 1);
+  }
+
+  DIR *d = opendir(dir.c_str());
+  if (d == nullptr)
+    return CLStatus(-1, errno);
+
+  // 段文件名为 base.N 或 base.N.gz
+  std::vector<std::pair<uint64_t, bool>> found;
+  std::string prefix = base + ".";
+  while (struct dirent *entry = readdir(d)) {
+    std::string name = entry->d_name;
+    if (name.compare(0, prefix.size(), prefix) != 0)
+      continue;
+    const char *p = name.c_str() + prefix.size();
+    char *end;
+    if (*p < '0' || *p > '9')
+      continue;
+    uint64_t seq = strtoull(p, &end, 10);
+    if (*end == '\0') {
+      found.push_back({seq, false});
+    } else if (strcmp(end, ".gz") == 0) {
+      found.push_back({seq, true});
+    } else if (strcmp(end, ".gz.tmp") == 0) {
+      // 压缩到一半时退出留下的临时文件，原段仍在
+      unlink((dir + "/" + name).c_str());
+    }
+  }
+  closedir(d);
+  std::sort(found.begin(), found.end());
+
+  uint64_t start = 0;
+  for (size_t i = 0; i < found.size(); ++i) {
+    uint64_t seq = found[i].first;
+    bool compressed = found[i].second;
+    // 压缩完成但未及删除原段时，两者同时存在，以压缩后的为准
+    if (!compressed && i + 1 < found.size() && found[i + 1].first == seq) {
+      unlink(SegmentPath(seq).c_str());
+      continue;
+    }
+
+    Segment seg;
+    seg.seq = seq;
+    seg.path = SegmentPath(seq) + (compressed ? ".gz" : "");
+    seg.compressed = compressed;
+    seg.start = start;
+
+    int fd = open(seg.path.c_str(), O_RDONLY);
+    if (fd == -1)
+      return CLStatus(-1, errno);
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+      close(fd);
+      return CLStatus(-1, errno);
+    }
+    if (compressed) {
+      CLStatus s = CompressedSize(fd, seg.size);
+      close(fd);
+      if (!s.IsSuccess())
+        return s;
+    } else {
+      seg.size = st.st_size;
+      seg.file = std::make_shared<CLLogFile>(fd, start, seg.size);
+      if (compress_)
+        compress_queue_.push_back(seq);
+    }
+
+    start += seg.size;
+    next_seq_ = seq + 1;
+    segments_.push_back(seg);
+  }
+
+  EnforceRetention();
+  return CLStatus(0, 0);
+}
+
+CLStatus CLLogSegments::CompressedSize(int fd, uint64_t &size) {
+  // 头部：ID1 ID2 CM FLG MTIME(4) XFL OS，FLG 含 FEXTRA 时其后为
+  // 2 字节的 XLEN 与各子字段（SI1 SI2 LEN(2) 数据）
+  unsigned char head[12 + 64];
+  ssize_t n = pread(fd, head, sizeof(head), 0);
+  if (n >= 12 && head[0] == 0x1f && head[1] == 0x8b && (head[3] & 4)) {
+    size_t end = std::min<size_t>(n, 12 + (head[10] | head[11] << 8));
+    for (size_t p = 12; p + 4 <= end;) {
+      size_t len = head[p + 2] | head[p + 3] << 8;
+      if (head[p] == SIZE_FIELD_ID[0] && head[p + 1] == SIZE_FIELD_ID[1] &&
+          len == SIZE_FIELD_LEN && p + 4 + len <= end) {
+        size = 0;
+        for (size_t i = 0; i < SIZE_FIELD_LEN; ++i)
+          size |= (uint64_t)head[p + 4 + i] << (8 * i);
+        return CLStatus(0, 0);
+      }
+      p += 4 + len;
+    }
+  }
+
+  // 没有记录长度的压缩段：尾部的 ISIZE 只是长度模 2^32，解压一遍计数
+  int dup_fd = dup(fd);
+  if (dup_fd == -1)
+    return CLStatus(-1, errno);
+  lseek(dup_fd, 0, SEEK_SET);
+  gzFile in = gzdopen(dup_fd, "rb");
+  if (in == nullptr) {
+    close(dup_fd);
+    return CLStatus(-1, ENOMEM);
+  }
+  std::unique_ptr<char[]> buf(new char[1 << 16]);
+  size = 0;
+  int got;
+  while ((got = gzread(in, buf.get(), 1 << 16)) > 0)
+    size += got;
+  gzclose(in);
+  return got < 0 ? CLStatus(-1, EIO) : CLStatus(0, 0);
+}
+
+void CLLogSegments::Close() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  cv_.notify_one();
+  compress_cv_.notify_one();
+  if (maintenance_.joinable())
+    maintenance_.join();
+  if (compressor_.joinable())
+    compressor_.join();
+}
+
+CLLogFile *CLLogSegments::Acquire() {
+  // 先登记再确认仍是当前段，轮转线程等待登记数归零后才认为旧段写入完毕
+  while (true) {
+    CLLogFile *file = current_.load();
+    file->writers.fetch_add(1);
+    if (current_.load() == file)
+      return file;
+    file->writers.fetch_sub(1);
+  }
+}
+
+void CLLogSegments::Release(CLLogFile *file, uint64_t written) {
+  uint64_t size = file->size.fetch_add(written) + written;
+  if (rotate_bytes_ != 0 && size >= rotate_bytes_ &&
+      !rotate_requested_.exchange(true)) {
+    { std::lock_guard<std::mutex> lock(mutex_); }
+    cv_.notify_one();
+  }
+  file->writers.fetch_sub(1);
+}
+
+int CLLogSegments::ActiveFd() { return current_.load()->fd; }
+
+uint64_t CLLogSegments::Generation() const {
+  return generation_.load(std::memory_order_acquire);
+}
+
+CLStatus CLLogSegments::Sync() {
+  // 轮转期间新旧两个段都可能含有未落盘的数据
+  std::vector<std::shared_ptr<CLLogFile>> files;
+  {
+    std::lock_guard<std::mutex> lock(mutex_for_segments_);
+    files = unsynced_;
+    files.push_back(active_);
+  }
+
+  for (auto &file : files) {
+    if (fdatasync(file->fd) == -1)
+      return CLStatus(-1, errno);
+  }
+  return CLStatus(0, 0);
+}
+
+CLStatus CLLogSegments::Rotate() {
+  uint64_t seq = next_seq_;
+  std::string seg_path = SegmentPath(seq);
+
+  // 先改名：仍持有旧文件标识符的写入者继续写入的内容都落在该段中
+  if (rename(path_.c_str(), seg_path.c_str()) == -1)
+    return CLStatus(-1, errno);
+  int fd = open(path_.c_str(), O_RDWR | O_CREAT | O_APPEND, S_IRUSR | S_IWUSR);
+  if (fd == -1) {
+    int err = errno;
+    rename(seg_path.c_str(), path_.c_str());
+    return CLStatus(-1, err);
+  }
+  ++next_seq_;
+
+  std::shared_ptr<CLLogFile> next = std::make_shared<CLLogFile>(fd, 0, 0);
+  std::shared_ptr<CLLogFile> old;
+  {
+    std::lock_guard<std::mutex> lock(mutex_for_segments_);
+    old = active_;
+    unsynced_.push_back(old);
+    unsynced_.push_back(next);
+  }
+
+  // 原子地替换当前段，之后获取的写入者都写入新段；
+  // 等待仍在写旧段的写入者完成，旧段的长度随之确定
+  current_.store(next.get());
+  generation_.fetch_add(1, std::memory_order_release);
+  while (old->writers.load() != 0)
+    std::this_thread::yield();
+
+  // 压缩后会删除原段，先保证其内容已落盘
+  fdatasync(old->fd);
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_for_segments_);
+    next->start = old->start + old->size.load();
+    active_ = next;
+    unsynced_.clear();
+
+    Segment seg;
+    seg.seq = seq;
+    seg.path = seg_path;
+    seg.compressed = false;
+    seg.start = old->start;
+    seg.size = old->size.load();
+    seg.file = old;
+    segments_.push_back(seg);
+    EnforceRetention();
+  }
+
+  if (compress_) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      compress_queue_.push_back(seq);
+    }
+    compress_cv_.notify_one();
+  }
+
+  return CLStatus(0, 0);
+}
+
+void CLLogSegments::EnforceRetention() {
+  while (retention_ != 0 && segments_.size() > retention_) {
+    unlink(segments_.front().path.c_str());
+    segments_.erase(segments_.begin());
+  }
+}
+
+void CLLogSegments::MaintenanceLoop() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!stop_) {
+    auto requested = [this]() { return stop_ || rotate_requested_.load(); };
+    if (rotate_interval_s_ != 0)
+      cv_.wait_until(lock,
+                     opened_at_ + std::chrono::seconds(rotate_interval_s_),
+                     requested);
+    else
+      cv_.wait(lock, requested);
+    if (stop_)
+      break;
+
+    auto now = std::chrono::steady_clock::now();
+    bool due = rotate_requested_.load();
+    if (!due && rotate_interval_s_ != 0 &&
+        now - opened_at_ >= std::chrono::seconds(rotate_interval_s_)) {
+      // 时间到了但当前段为空时不轮转，重新计时
+      if (current_.load()->size.load() > 0)
+        due = true;
+      else
+        opened_at_ = now;
+    }
+    if (!due)
+      continue;
+
+    lock.unlock();
+    CLStatus s = Rotate();
+    lock.lock();
+    if (s.IsSuccess())
+      opened_at_ = std::chrono::steady_clock::now();
+    // 轮转期间新段可能已再次写满
+    rotate_requested_.store(rotate_bytes_ != 0 &&
+                            current_.load()->size.load() >= rotate_bytes_);
+    if (!s.IsSuccess()) {
+      rotate_requested_.store(false);
+      cv_.wait_for(lock, std::chrono::seconds(1), [this]() { return stop_; });
+    }
+  }
+}
+
+void CLLogSegments::CompressLoop() {
+  // 以最低的 CPU 与 I/O 优先级运行，不与写入者争用资源
+  pid_t tid = syscall(SYS_gettid);
+  setpriority(PRIO_PROCESS, tid, 19);
+  syscall(SYS_ioprio_set, 1 /* IOPRIO_WHO_PROCESS */, tid,
+          3 << 13 /* IOPRIO_CLASS_IDLE */);
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    compress_cv_.wait(lock,
+                      [this]() { return stop_ || !compress_queue_.empty(); });
+    if (stop_)
+      break;
+    uint64_t seq = compress_queue_.front();
+    compress_queue_.pop_front();
+    lock.unlock();
+    Compress(seq);
+    lock.lock();
+  }
+}
+
+CLStatus CLLogSegments::Compress(uint64_t seq) {
+  std::shared_ptr<CLLogFile> file;
+  std::string src;
+  uint64_t size = 0;
+  {
+    std::lock_guard<std::mutex> lock(mutex_for_segments_);
+    for (auto &seg : segments_) {
+      if (seg.seq == seq && !seg.compressed) {
+        file = seg.file;
+        src = seg.path;
+        size = seg.size;
+      }
+    }
+  }
+  if (file == nullptr)
+    return CLStatus(0, 0); // 已被删除
+
+  std::string dst = src + ".gz";
+  std::string tmp = dst + ".tmp";
+  int out_fd =
+      open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+  if (out_fd == -1)
+    return CLStatus(-1, errno);
+  // 未压缩的长度写入 gzip 头部的扩展字段，打开时不必解压即可得到
+  unsigned char extra[4 + SIZE_FIELD_LEN] = {SIZE_FIELD_ID[0],
+                                             SIZE_FIELD_ID[1], SIZE_FIELD_LEN,
+                                             0};
+  for (size_t i = 0; i < SIZE_FIELD_LEN; ++i)
+    extra[4 + i] = size >> (8 * i);
+  gz_header header;
+  memset(&header, 0, sizeof(header));
+  header.extra = extra;
+  header.extra_len = sizeof(extra);
+  header.os = 3; // Unix
+
+  z_stream zs;
+  memset(&zs, 0, sizeof(zs));
+  if (deflateInit2(&zs, 6, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) !=
+      Z_OK) {
+    close(out_fd);
+    unlink(tmp.c_str());
+    return CLStatus(-1, ENOMEM);
+  }
+  bool ok = deflateSetHeader(&zs, &header) == Z_OK;
+
+  std::unique_ptr<char[]> buf(new char[1 << 20]);
+  std::unique_ptr<char[]> zbuf(new char[1 << 18]);
+  uint64_t offset = 0;
+  int flush = Z_NO_FLUSH;
+  while (ok && flush != Z_FINISH) {
+    ssize_t n = pread(file->fd, buf.get(), 1 << 20, offset);
+    if (n == -1 && errno == EINTR)
+      continue;
+    if (n == -1) {
+      ok = false;
+      break;
+    }
+    offset += n;
+    flush = n == 0 ? Z_FINISH : Z_NO_FLUSH;
+    zs.next_in = reinterpret_cast<Bytef *>(buf.get());
+    zs.avail_in = n;
+    do {
+      zs.next_out = reinterpret_cast<Bytef *>(zbuf.get());
+      zs.avail_out = 1 << 18;
+      deflate(&zs, flush);
+      size_t have = (1 << 18) - zs.avail_out;
+      for (size_t put = 0; ok && put < have;) {
+        ssize_t w = write(out_fd, zbuf.get() + put, have - put);
+        if (w == -1 && errno == EINTR)
+          continue;
+        ok = w > 0;
+        put += ok ? w : 0;
+      }
+    } while (ok && zs.avail_out == 0);
+  }
+  deflateEnd(&zs);
+  // 段在轮转后不再写入，读到的长度应与头部记录的一致；
+  // 删除原段前保证压缩文件已落盘
+  ok = ok && offset == size && fsync(out_fd) == 0;
+  close(out_fd);
+  if (!ok || rename(tmp.c_str(), dst.c_str()) == -1) {
+    unlink(tmp.c_str());
+    return CLStatus(-1, EIO);
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_for_segments_);
+  for (auto &seg : segments_) {
+    if (seg.seq == seq) {
+      unlink(src.c_str());
+      seg.path = dst;
+      seg.compressed = true;
+      seg.file.reset();
+      return CLStatus(0, 0);
+    }
+  }
+  // 压缩期间该段因超出保留数量被删除
+  unlink(dst.c_str());
+  return CLStatus(0, 0);
+}
+
+uint64_t CLLogSegments::BeginOffset() {
+  std::lock_guard<std::mutex> lock(mutex_for_segments_);
+  return segments_.empty() ? active_->start : segments_.front().start;
+}
+
+uint64_t CLLogSegments::ActiveStart() {
+  std::lock_guard<std::mutex> lock(mutex_for_segments_);
+  return active_->start;
+}
+
+uint64_t CLLogSegments::EndOffset() {
+  std::lock_guard<std::mutex> lock(mutex_for_segments_);
+  return active_->start + active_->size.load();
+}
+
+CLStatus CLLogSegments::ReadAt(uint64_t offset, char *buf, size_t len) {
+  size_t done = 0;
+  while (done < len) {
+    uint64_t pos = offset + done;
+
+    // 在段表中找到包含 pos 的段；压缩段在持锁时打开，避免期间被删除。
+    // 读压缩段时持有 gz_lock 直到本段读完
+    std::shared_ptr<CLLogFile> file;
+    std::unique_lock<std::mutex> gz_lock;
+    uint64_t start = 0;
+    uint64_t size = 0;
+    {
+      std::lock_guard<std::mutex> lock(mutex_for_segments_);
+      for (auto &seg : segments_) {
+        if (pos >= seg.start && pos < seg.start + seg.size) {
+          start = seg.start;
+          size = seg.size;
+          if (seg.compressed) {
+            gz_lock = std::unique_lock<std::mutex>(mutex_for_gz_);
+            if (!gz_reader_ || gz_reader_->seq != seg.seq) {
+              gz_reader_.reset();
+              int gz_fd = open(seg.path.c_str(), O_RDONLY);
+              if (gz_fd == -1)
+                return CLStatus(-1, errno);
+              gzFile in = gzdopen(gz_fd, "rb");
+              if (in == nullptr) {
+                close(gz_fd);
+                return CLStatus(-1, ENOMEM);
+              }
+              gzbuffer(in, 1 << 16);
+              gz_reader_.reset(new GzReader{seg.seq, in});
+            }
+          } else {
+            file = seg.file;
+          }
+          break;
+        }
+      }
+      if (file == nullptr && !gz_lock.owns_lock()) {
+        if (pos < (segments_.empty() ? active_->start
+                                     : segments_.front().start))
+          return done > 0 ? CLStatus(done, 0) : CLStatus(-1, ERANGE);
+        if (pos < active_->start)
+          break;
+        file = active_;
+        start = active_->start;
+        size = UINT64_MAX - start;
+      }
+    }
+
+    size_t want = std::min<uint64_t>(len - done, start + size - pos);
+    ssize_t n;
+    if (gz_lock.owns_lock()) {
+      // 顺序读取时解压位置正好在 pos；跳到更大的偏移时 gzseek 从当前
+      // 位置继续解压，只有跳回之前的偏移时才从头开始
+      gzFile in = gz_reader_->in;
+      n = (uint64_t)gztell(in) != pos - start &&
+                  gzseek(in, pos - start, SEEK_SET) == -1
+              ? -1
+              : gzread(in, buf + done, want);
+      if (n == -1) {
+        gz_reader_.reset();
+        return CLStatus(-1, EIO);
+      }
+    } else {
+      n = pread(file->fd, buf + done, want, pos - start);
+      if (n == -1) {
+        if (errno == EINTR)
+          continue;
+        return CLStatus(-1, errno);
+      }
+    }
+    if (n == 0)
+      break;
+    done += n;
+  }
+
+  return CLStatus(done, 0);
+}
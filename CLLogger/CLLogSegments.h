@@ -0,0 +1,122 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <zlib.h>
+
+#include "CLStatus.h"
+
+// 一个打开的日志段文件
+class CLLogFile {
+public:
+  CLLogFile(int fd, uint64_t start, uint64_t size)
+      : fd(fd), start(start), size(size), writers(0) {}
+  ~CLLogFile();
+
+  const int fd;
+  uint64_t start;              // 在整个日志中的起始偏移
+  std::atomic<uint64_t> size;  // 已写入的字节数
+  std::atomic<int> writers;    // 正在写入该文件的线程数
+
+private:
+  CLLogFile(const CLLogFile &) = delete;
+  CLLogFile &operator=(const CLLogFile &) = delete;
+};
+
+// 分段日志文件：当前段写满或到达时间间隔后轮转为 path.N（N 递增），
+// 新建 path 继续写入；轮转只原子地替换当前文件指针，写入者不会被阻塞。
+// 轮转出的段在低优先级的后台线程上压缩为 path.N.gz（gzip 头部的扩展字段
+// 记录未压缩的长度），超出保留数量的最旧段被删除。
+// 所有保留的段与当前段按顺序组成一个连续的日志，可按偏移读取
+class CLLogSegments {
+public:
+  // rotate_bytes 为 0 时不按大小轮转，rotate_interval_s 为 0 时不按时间轮转，
+  // retention 为保留的已轮转段数，为 0 时全部保留
+  CLLogSegments(const std::string &path, uint64_t rotate_bytes,
+                unsigned rotate_interval_s, size_t retention, bool compress);
+  ~CLLogSegments();
+
+  CLStatus Open();  // 打开当前段，加载已有的段并启动后台线程
+  void Close();     // 停止后台线程
+
+  // 获取当前段用于写入，写完后必须以写入的字节数调用 Release
+  CLLogFile *Acquire();
+  void Release(CLLogFile *file, uint64_t written);
+  int ActiveFd(); // 当前段的文件标识符（不轮转时使用）
+  uint64_t Generation() const; // 轮转次数，每替换一次当前段加一
+
+  CLStatus Sync(); // 所有可能含有未落盘数据的段执行 fdatasync
+
+  // 从日志偏移 offset 处读取最多 len 字节，可跨越多个段；
+  // 返回值的 ReturnCode 为读取的字节数，到达日志末尾时小于 len
+  CLStatus ReadAt(uint64_t offset, char *buf, size_t len);
+  uint64_t BeginOffset(); // 最旧的保留段的起始偏移
+  uint64_t ActiveStart(); // 当前段的起始偏移
+  uint64_t EndOffset();   // 已写入的日志长度（轮转期间不含新段）
+
+private:
+  CLLogSegments(const CLLogSegments &) = delete;
+  CLLogSegments &operator=(const CLLogSegments &) = delete;
+
+  // 一个已轮转的段
+  struct Segment {
+    uint64_t seq;
+    std::string path;
+    bool compressed;
+    uint64_t start;
+    uint64_t size;                   // 未压缩的字节数
+    std::shared_ptr<CLLogFile> file; // 尚未压缩时保持打开
+  };
+
+  // 最近读取的压缩段及其解压位置，顺序读取时接着上次的位置解压
+  struct GzReader {
+    uint64_t seq;
+    gzFile in;
+    ~GzReader() { gzclose(in); }
+  };
+
+  std::string SegmentPath(uint64_t seq) const;
+  static CLStatus CompressedSize(int fd, uint64_t &size); // 未压缩的长度
+  CLStatus LoadSegments(); // 扫描目录中已有的段
+  CLStatus Rotate();
+  void EnforceRetention(); // 调用者持有 mutex_for_segments_
+  void MaintenanceLoop();  // 检查轮转条件
+  void CompressLoop();     // 低优先级压缩已轮转的段
+  CLStatus Compress(uint64_t seq);
+
+  std::string path_;
+  uint64_t rotate_bytes_;
+  unsigned rotate_interval_s_;
+  size_t retention_;
+  bool compress_;
+
+  std::atomic<CLLogFile *> current_;  // 写入者使用的当前段
+  std::atomic<uint64_t> generation_;  // 轮转次数
+  std::shared_ptr<CLLogFile> active_; // 当前段的所有者，读取时使用
+  std::chrono::steady_clock::time_point opened_at_; // 当前段的创建时间
+  uint64_t next_seq_;
+
+  std::mutex mutex_for_segments_; // 保护 segments_、active_ 与 unsynced_
+  std::vector<Segment> segments_; // 已轮转的段，按 seq 递增
+  std::vector<std::shared_ptr<CLLogFile>> unsynced_; // 轮转后尚未落盘的段
+
+  std::mutex mutex_for_gz_;             // 保护 gz_reader_，在段表锁之后获取
+  std::unique_ptr<GzReader> gz_reader_; // 没有读过压缩段时为空
+
+  std::atomic<bool> rotate_requested_; // 当前段已达到大小阈值
+  bool stop_;
+  std::mutex mutex_;               // 配合条件变量使用
+  std::condition_variable cv_;     // 唤醒维护线程
+  std::condition_variable compress_cv_; // 唤醒压缩线程
+  std::deque<uint64_t> compress_queue_; // 等待压缩的段
+  std::thread maintenance_;
+  std::thread compressor_;
+};
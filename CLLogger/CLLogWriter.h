@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstddef>
+#include <sys/uio.h>
+
+#include "CLStatus.h"
+
+// 日志写入后端接口，CLFileRW 按配置的写入模式选择具体实现
+class CLLogWriter {
+public:
+  virtual ~CLLogWriter() {}
+
+  // 把一组缓冲区拼接为一条消息追加，消息内容在返回前已被复制
+  virtual CLStatus Write(const struct iovec *iov, int iovcnt) = 0;
+  virtual CLStatus Flush() = 0;    // 等待此前追加的消息全部写入文件
+  virtual CLStatus Shutdown() = 0; // 写完所有消息并停止后台线程
+};
@@ -0,0 +1,274 @@
+#include "CLMmapWriter.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <libgen.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+const uint64_t CLMmapWriter::CLOSED_BIT_ = 1ull << 63;
+const uint64_t CLMmapWriter::IDLE_ = UINT64_MAX;
+std::atomic<uint64_t> CLMmapWriter::next_id_(1);
+
+// 线程局部缓存：最近使用的写入后端编号及其槽位
+struct CLMmapLocal {
+  uint64_t id = 0;
+  std::shared_ptr<void> slot;
+};
+static thread_local CLMmapLocal local_;
+
+CLMmapWriter::CLMmapWriter(int fd, const std::string &marker, Sink sink,
+                           Notify notify, size_t extent_size, size_t max_size)
+    : fd_(fd), marker_(marker), marker_fd_(-1), sink_(sink), notify_(notify), base_(nullptr), tail_(0),
+      mapped_(0), start_(0), id_(next_id_.fetch_add(1)), stopped_(false),
+      error_code_(0) {
+  // 映射的长度与文件偏移都必须按页对齐
+  uint64_t page = sysconf(_SC_PAGESIZE);
+  extent_size_ = (extent_size + page - 1) / page * page;
+  if (extent_size_ == 0)
+    extent_size_ = page;
+  max_size_ = (max_size + extent_size_ - 1) / extent_size_ * extent_size_;
+
+  CLStatus s = Recover(fd_, marker_);
+  if (!s.IsSuccess())
+    throw "In CLMmapWriter::CLMmapWriter(), recover error";
+  start_ = s.ReturnCode();
+  tail_.store(start_);
+
+  // 预分配之前先让标记文件落盘，崩溃后才能区分零字节是否为预分配
+  marker_fd_ = open(marker_.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                    S_IRUSR | S_IWUSR);
+  if (marker_fd_ == -1)
+    throw "In CLMmapWriter::CLMmapWriter(), open marker error";
+  std::string dir = marker_;
+  int dir_fd = open(dirname(&dir[0]), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  bool synced = pwrite(marker_fd_, &start_, sizeof(start_), 0) ==
+                    (ssize_t)sizeof(start_) &&
+                fsync(marker_fd_) == 0 && dir_fd != -1 && fsync(dir_fd) == 0;
+  if (dir_fd != -1)
+    close(dir_fd);
+  if (!synced) {
+    close(marker_fd_);
+    unlink(marker_.c_str());
+    throw "In CLMmapWriter::CLMmapWriter(), write marker error";
+  }
+
+  // 只预留地址空间，不占用内存；各段在写到时再映射到文件上
+  void *p = mmap(nullptr, max_size_, PROT_NONE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (p == MAP_FAILED) {
+    close(marker_fd_);
+    unlink(marker_.c_str());
+    throw "In CLMmapWriter::CLMmapWriter(), mmap error";
+  }
+  base_ = static_cast<char *>(p);
+}
+
+CLMmapWriter::~CLMmapWriter() { Shutdown(); }
+
+std::string CLMmapWriter::MarkerPath(const std::string &path) {
+  return path + ".mmap";
+}
+
+CLStatus CLMmapWriter::Recover(int fd, const std::string &marker) {
+  struct stat st;
+  if (fstat(fd, &st) == -1)
+    return CLStatus(-1, errno);
+
+  // 没有标记：上次不是映射模式或已正常关闭，文件长度就是写入的长度
+  int marker_fd = open(marker.c_str(), O_RDONLY | O_CLOEXEC);
+  if (marker_fd == -1) {
+    if (errno == ENOENT)
+      return CLStatus(st.st_size, 0);
+    return CLStatus(-1, errno);
+  }
+  // 标记中的长度之前都是已确认的消息；内容未落盘时从 0 开始查找
+  uint64_t floor = 0;
+  if (pread(marker_fd, &floor, sizeof(floor), 0) != (ssize_t)sizeof(floor))
+    floor = 0;
+  close(marker_fd);
+  floor = std::min<uint64_t>(floor, st.st_size);
+
+  // 从文件末尾向前查找最后一个非零字节，不越过 floor
+  char buf[64 << 10];
+  off_t end = st.st_size;
+  while (end > (off_t)floor) {
+    off_t begin = end - (off_t)floor > (off_t)sizeof(buf)
+                      ? end - (off_t)sizeof(buf)
+                      : (off_t)floor;
+    ssize_t n = pread(fd, buf, end - begin, begin);
+    if (n == -1) {
+      if (errno == EINTR)
+        continue;
+      return CLStatus(-1, errno);
+    }
+    if (n != end - begin)
+      return CLStatus(-1, EIO);
+
+    ssize_t i = n;
+    while (i > 0 && buf[i - 1] == 0)
+      --i;
+    if (i > 0) {
+      end = begin + i;
+      break;
+    }
+    end = begin;
+  }
+
+  // 截断落盘后再删除标记，否则再次崩溃时零字节会被当作消息
+  if (end != st.st_size && (ftruncate(fd, end) == -1 || fsync(fd) == -1))
+    return CLStatus(-1, errno);
+  if (unlink(marker.c_str()) == -1 && errno != ENOENT)
+    return CLStatus(-1, errno);
+  return CLStatus(end, 0);
+}
+
+CLStatus CLMmapWriter::Extend(uint64_t end) {
+  std::lock_guard<std::mutex> lock(mutex_for_extend_);
+
+  uint64_t mapped = mapped_.load(std::memory_order_relaxed);
+  while (mapped < end) {
+    if (mapped + extent_size_ > max_size_)
+      return CLStatus(-1, EFBIG);
+
+    // 预分配磁盘空间，文件系统不支持时退化为扩展文件长度
+    if (fallocate(fd_, 0, mapped, extent_size_) == -1) {
+      if (errno != EOPNOTSUPP)
+        return CLStatus(-1, errno);
+      if (ftruncate(fd_, mapped + extent_size_) == -1)
+        return CLStatus(-1, errno);
+    }
+
+    void *p = mmap(base_ + mapped, extent_size_, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_FIXED, fd_, mapped);
+    if (p == MAP_FAILED)
+      return CLStatus(-1, errno);
+
+    mapped += extent_size_;
+    mapped_.store(mapped, std::memory_order_release);
+  }
+
+  return CLStatus(0, 0);
+}
+
+CLMmapWriter::Slot *CLMmapWriter::LocalSlot() {
+  if (local_.id != id_) {
+    std::shared_ptr<Slot> slot = std::make_shared<Slot>();
+    slot->begin.store(IDLE_);
+    {
+      std::lock_guard<std::mutex> lock(mutex_for_slots_);
+      // 引用者只剩 slots_ 时，所属线程已退出或改用其他写入后端，
+      // 其槽位一定空闲，移除后 StableEnd 不必再扫描
+      slots_.erase(std::remove_if(slots_.begin(), slots_.end(),
+                                  [](const std::shared_ptr<Slot> &s) {
+                                    return s.use_count() == 1;
+                                  }),
+                   slots_.end());
+      slots_.push_back(slot);
+    }
+    local_.id = id_;
+    local_.slot = slot;
+  }
+  return static_cast<Slot *>(local_.slot.get());
+}
+
+CLStatus CLMmapWriter::Write(const struct iovec *iov, int iovcnt) {
+  uint64_t len = 0;
+  for (int i = 0; i < iovcnt; ++i)
+    len += iov[i].iov_len;
+  if (len == 0)
+    return CLStatus(0, 0);
+
+  // 预留前先公布偏移的下界：StableEnd 先读 tail_ 再扫描槽位，
+  // 预留在其读 tail_ 之前的写入者此时一定已公布下界
+  Slot *slot = LocalSlot();
+  slot->begin.store(tail_.load() & ~CLOSED_BIT_);
+  uint64_t offset = tail_.fetch_add(len);
+  if (offset & CLOSED_BIT_) {
+    slot->begin.store(IDLE_);
+    // 已关闭：等待 Shutdown 截断文件后直接追加写入
+    std::lock_guard<std::mutex> lock(mutex_for_shutdown_);
+    return sink_(iov, iovcnt);
+  }
+
+  uint64_t end = offset + len;
+  if (end > mapped_.load(std::memory_order_acquire)) {
+    CLStatus s = Extend(end);
+    if (!s.IsSuccess()) {
+      // 预留的区间无法写入，仍视为已完成，避免 Flush 一直等待
+      slot->begin.store(IDLE_);
+      std::lock_guard<std::mutex> lock(mutex_for_shutdown_);
+      error_code_ = s.ErrorCode();
+      return s;
+    }
+  }
+
+  char *dst = base_ + offset;
+  for (int i = 0; i < iovcnt; ++i) {
+    memcpy(dst, iov[i].iov_base, iov[i].iov_len);
+    dst += iov[i].iov_len;
+  }
+  slot->begin.store(IDLE_);
+  notify_(len);
+
+  return CLStatus(0, 0);
+}
+
+void CLMmapWriter::WaitCommitted(uint64_t end) {
+  // 之后预留的写入者不会使 StableEnd 小于 end，
+  // 只需等待已预留的区间复制完成，让出 CPU 等待即可
+  while (StableEnd() < end)
+    std::this_thread::yield();
+}
+
+uint64_t CLMmapWriter::StableEnd() {
+  // 正在复制的区间中最小的起始偏移之前都已写入
+  uint64_t end = tail_.load() & ~CLOSED_BIT_;
+  std::lock_guard<std::mutex> lock(mutex_for_slots_);
+  for (auto &slot : slots_)
+    end = std::min(end, slot->begin.load());
+  return end;
+}
+
+CLStatus CLMmapWriter::Flush() {
+  // 映射与文件共享页缓存，复制完成后即对 read 可见
+  uint64_t end = tail_.load() & ~CLOSED_BIT_;
+  WaitCommitted(end);
+
+  std::lock_guard<std::mutex> lock(mutex_for_shutdown_);
+  // 更新标记中已确认的长度，崩溃恢复时不会去掉其中以零字节结尾的消息
+  if (!stopped_ && end > start_ &&
+      pwrite(marker_fd_, &end, sizeof(end), 0) == -1 && error_code_ == 0)
+    error_code_ = errno;
+  if (error_code_ != 0)
+    return CLStatus(-1, error_code_);
+  return CLStatus(0, 0);
+}
+
+CLStatus CLMmapWriter::Shutdown() {
+  std::lock_guard<std::mutex> lock(mutex_for_shutdown_);
+  if (!stopped_) {
+    stopped_ = true;
+    uint64_t end = tail_.fetch_or(CLOSED_BIT_) & ~CLOSED_BIT_;
+    WaitCommitted(end);
+
+    munmap(base_, max_size_);
+    // 去掉预分配但未写入的部分
+    if (ftruncate(fd_, end) == -1) {
+      if (error_code_ == 0)
+        error_code_ = errno;
+    } else {
+      // 文件长度已准确，删除标记，之后以任何模式打开都不再去掉零字节
+      unlink(marker_.c_str());
+    }
+    close(marker_fd_);
+  }
+
+  if (error_code_ != 0)
+    return CLStatus(-1, error_code_);
+  return CLStatus(0, 0);
+}
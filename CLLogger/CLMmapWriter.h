@@ -0,0 +1,87 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <sys/uio.h>
+#include <vector>
+
+#include "CLLogWriter.h"
+
+// 内存映射追加写入后端：日志文件按大块预分配（fallocate）并映射到一段
+// 预留的连续虚拟地址上，写入者用原子 fetch_add 预留文件偏移后直接 memcpy
+// 到映射中，每条消息不需要系统调用。
+// 运行期间存在标记文件 path.mmap，记录已确认写入的文件长度；正常关闭时
+// 把文件截断到实际写入的长度并删除标记。崩溃后重新打开时由 Recover
+// 去掉末尾预分配但未写入的零字节
+class CLMmapWriter : public CLLogWriter {
+public:
+  // 关闭后直接写入文件的回调
+  typedef std::function<CLStatus(const struct iovec *, int)> Sink;
+  // 消息写入映射后的通知，参数为字节数
+  typedef std::function<void(uint64_t)> Notify;
+
+  // fd 为已打开的日志文件，marker 为其标记文件（见 MarkerPath），
+  // extent_size 为每次预分配与映射的字节数，
+  // max_size 为预留的虚拟地址空间大小，即文件的最大长度
+  CLMmapWriter(int fd, const std::string &marker, Sink sink, Notify notify,
+               size_t extent_size, size_t max_size);
+  virtual ~CLMmapWriter();
+
+  virtual CLStatus Write(const struct iovec *iov, int iovcnt);
+  virtual CLStatus Flush();
+  virtual CLStatus Shutdown();
+
+  // 返回此时已连续写入的文件长度，之前的区间都已复制完成，不等待
+  uint64_t StableEnd();
+
+  // 日志文件 path 的标记文件路径
+  static std::string MarkerPath(const std::string &path);
+
+  // 标记文件存在时，上次以映射模式运行且未正常关闭：去掉文件末尾
+  // 标记记录的长度之后的零字节（预分配但未写入的部分），然后删除标记。
+  // 标记不存在时不修改文件。返回文件长度
+  static CLStatus Recover(int fd, const std::string &marker);
+
+private:
+  CLMmapWriter(const CLMmapWriter &) = delete;
+  CLMmapWriter &operator=(const CLMmapWriter &) = delete;
+
+  // 一个写入线程正在复制的区间的起始偏移下界，空闲时为 IDLE_
+  struct Slot {
+    alignas(64) std::atomic<uint64_t> begin;
+  };
+
+  CLStatus Extend(uint64_t end); // 预分配并映射直到覆盖 [0, end)
+  Slot *LocalSlot();             // 当前线程的槽位，首次调用时注册
+  void WaitCommitted(uint64_t end);
+
+  int fd_;
+  std::string marker_;
+  int marker_fd_; // 标记文件，Flush 时更新其中记录的长度
+  Sink sink_;
+  Notify notify_;
+  uint64_t extent_size_;
+  uint64_t max_size_;
+  char *base_; // 预留虚拟地址空间的起始地址
+
+  alignas(64) std::atomic<uint64_t> tail_;   // 下一条消息的文件偏移
+  alignas(64) std::atomic<uint64_t> mapped_; // 已映射的文件长度
+  uint64_t start_;                           // 打开时的文件长度
+  uint64_t id_; // 区分不同的写入后端对象，用于线程局部缓存
+
+  std::mutex mutex_for_slots_;             // 保护 slots_
+  std::vector<std::shared_ptr<Slot>> slots_; // 已注册的写入线程槽位
+
+  std::mutex mutex_for_extend_;   // 串行化预分配与映射
+  std::mutex mutex_for_shutdown_; // 串行化 Shutdown，关闭后的写入等待其完成
+  bool stopped_;
+  long error_code_;
+
+  static const uint64_t CLOSED_BIT_; // tail_ 的最高位，置位后不再接受新消息
+  static const uint64_t IDLE_;
+  static std::atomic<uint64_t> next_id_;
+};
@@ -0,0 +1,494 @@
+#include "CLShardedWriter.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <fcntl.h>
+#include <queue>
+#include <sched.h>
+#include <sys/stat.h>
+#include <thread>
+#include <time.h>
+#include <unistd.h>
+
+const size_t CLShardedWriter::RECORD_OVERHEAD_ =
+    sizeof(CLShardRecordHeader) + sizeof(uint32_t);
+const uint64_t CLShardedWriter::IDLE_ = UINT64_MAX;
+const uint64_t CLShardMerger::CHECKPOINT_BYTES_ = 64 << 10;
+const size_t CLShardMerger::MAX_CHECKPOINTS_ = 1024;
+
+// 带缓存的顺序读取，按文件位置取一段连续的字节；
+// 分片文件只会追加，已缓存的内容不会失效
+class CLShardReader {
+public:
+  explicit CLShardReader(int fd) : fd_(fd), base_(0), size_(0) {}
+
+  // 取 [pos, pos + n) 的内容，文件长度不足或读取出错时返回 nullptr
+  const char *Fetch(uint64_t pos, size_t n) {
+    if (pos >= base_ && pos + n <= base_ + size_)
+      return buf_.data() + (pos - base_);
+
+    if (buf_.size() < std::max(n, BUFFER_SIZE_))
+      buf_.resize(std::max(n, BUFFER_SIZE_));
+    base_ = pos;
+    size_ = 0;
+    while (size_ < buf_.size()) {
+      ssize_t r = pread(fd_, buf_.data() + size_, buf_.size() - size_,
+                        base_ + size_);
+      if (r == -1 && errno == EINTR)
+        continue;
+      if (r <= 0)
+        break;
+      size_ += r;
+    }
+    return size_ >= n ? buf_.data() : nullptr;
+  }
+
+private:
+  int fd_;
+  uint64_t base_;           // 缓存内容的文件位置
+  size_t size_;             // 缓存中的有效字节数
+  std::vector<char> buf_;
+
+  static constexpr size_t BUFFER_SIZE_ = 16 << 10;
+};
+
+// 校验 pos 处的记录：完整时返回 true 并取出头部；
+// 文件在记录中间结束时 incomplete 为 true
+static bool ReadRecord(CLShardReader &reader, uint64_t pos, uint32_t index,
+                       CLShardRecordHeader &header, bool &incomplete) {
+  incomplete = false;
+  const char *p = reader.Fetch(pos, sizeof(header));
+  if (p == nullptr) {
+    incomplete = true;
+    return false;
+  }
+  memcpy(&header, p, sizeof(header));
+  if (header.shard != index)
+    return false;
+
+  uint64_t total = CLShardedWriter::RECORD_OVERHEAD_ + header.len;
+  p = reader.Fetch(pos + total - sizeof(uint32_t), sizeof(uint32_t));
+  if (p == nullptr) {
+    incomplete = true;
+    return false;
+  }
+  uint32_t trailer;
+  memcpy(&trailer, p, sizeof(trailer));
+  return trailer == total;
+}
+
+static std::string ShardPath(const std::string &path, size_t index) {
+  return path + ".s" + std::to_string(index);
+}
+
+static uint64_t MonotonicNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+CLShardedWriter::CLShardedWriter(const std::string &path, size_t shards,
+                                 Notify notify)
+    : notify_(notify) {
+  if (shards == 0)
+    shards = std::max(1u, std::thread::hardware_concurrency());
+
+  // 时间戳取自单调时钟，所有 CPU 上读到的值一致递增；
+  // 加上偏移使其接近实时时钟，重启后仍排在已有的记录之后
+  struct timespec real;
+  clock_gettime(CLOCK_REALTIME, &real);
+  epoch_ = real.tv_sec * 1000000000ll + real.tv_nsec - MonotonicNs();
+
+  // 上次以更多分片运行时留下的分片只读取，不再写入
+  uint64_t max_ts = 0;
+  for (size_t i = 0; i < shards || access(ShardPath(path, i).c_str(), F_OK) == 0;
+       ++i) {
+    std::string shard_path = ShardPath(path, i);
+    int fd = open(shard_path.c_str(),
+                  i < shards ? O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC
+                             : O_RDWR | O_CLOEXEC,
+                  0644);
+    if (fd == -1)
+      throw "In CLShardedWriter::CLShardedWriter(), open error";
+
+    uint64_t size = 0, next_seq = 0;
+    if (!Recover(fd, i, size, next_seq, max_ts).IsSuccess()) {
+      close(fd);
+      throw "In CLShardedWriter::CLShardedWriter(), recover error";
+    }
+    paths_.push_back(shard_path);
+
+    if (i >= shards) {
+      close(fd);
+      continue;
+    }
+    std::unique_ptr<Shard> shard(new Shard);
+    shard->index = i;
+    shard->fd = fd;
+    shard->seq = next_seq;
+    shard->size = size;
+    shards_.push_back(std::move(shard));
+  }
+
+  if (Now() <= max_ts)
+    epoch_ += max_ts + 1 - Now();
+}
+
+CLShardedWriter::~CLShardedWriter() {
+  Shutdown();
+  for (auto &shard : shards_)
+    close(shard->fd);
+}
+
+CLStatus CLShardedWriter::Recover(int fd, uint32_t index, uint64_t &size,
+                                  uint64_t &next_seq, uint64_t &max_ts) {
+  struct stat st;
+  if (fstat(fd, &st) == -1)
+    return CLStatus(-1, errno);
+
+  // 通常最后一条记录是完整的，由末尾的记录长度直接找到它
+  CLShardReader reader(fd);
+  CLShardRecordHeader header;
+  bool incomplete;
+  uint64_t end = st.st_size;
+  if (end >= RECORD_OVERHEAD_) {
+    uint32_t total;
+    const char *p = reader.Fetch(end - sizeof(total), sizeof(total));
+    if (p != nullptr) {
+      memcpy(&total, p, sizeof(total));
+      if (total >= RECORD_OVERHEAD_ && total <= end &&
+          ReadRecord(reader, end - total, index, header, incomplete) &&
+          RECORD_OVERHEAD_ + header.len == total) {
+        size = end;
+        next_seq = header.seq + 1;
+        max_ts = std::max(max_ts, header.ts);
+        return CLStatus(0, 0);
+      }
+    }
+  }
+
+  // 否则从头扫描到最后一条完整的记录，截断之后的部分
+  uint64_t pos = 0;
+  while (pos < end && ReadRecord(reader, pos, index, header, incomplete)) {
+    next_seq = header.seq + 1;
+    max_ts = std::max(max_ts, header.ts);
+    pos += RECORD_OVERHEAD_ + header.len;
+  }
+  if (pos != end && ftruncate(fd, pos) == -1)
+    return CLStatus(-1, errno);
+  size = pos;
+  return CLStatus(0, 0);
+}
+
+uint64_t CLShardedWriter::Now() const { return MonotonicNs() + epoch_; }
+
+CLShardedWriter::Shard &CLShardedWriter::LocalShard() {
+  int cpu = sched_getcpu();
+  if (cpu < 0)
+    cpu = std::hash<std::thread::id>()(std::this_thread::get_id()) % INT_MAX;
+  return *shards_[cpu % shards_.size()];
+}
+
+CLStatus CLShardedWriter::Write(const struct iovec *iov, int iovcnt) {
+  size_t len = 0;
+  for (int i = 0; i < iovcnt; ++i)
+    len += iov[i].iov_len;
+  if (len > UINT32_MAX - RECORD_OVERHEAD_)
+    return CLStatus(-1, EMSGSIZE);
+  uint32_t total = RECORD_OVERHEAD_ + len;
+
+  Shard &shard = LocalShard();
+  bool leader;
+  {
+    std::lock_guard<std::mutex> lock(shard.mutex_for_write);
+    // 分片空闲时先公布时间戳的下界再取时间，水位不会越过这条记录；
+    // 在锁内取时间，同一分片内的时间戳随序号不减
+    if (shard.pending_min_ts.load() == IDLE_)
+      shard.pending_min_ts.store(Now());
+    CLShardRecordHeader header = {Now(), shard.seq++, shard.index,
+                                  static_cast<uint32_t>(len)};
+    std::vector<char> &buf = shard.write_buffer;
+    if (buf.empty())
+      shard.buffer_min_ts = header.ts;
+
+    const char *h = reinterpret_cast<const char *>(&header);
+    buf.insert(buf.end(), h, h + sizeof(header));
+    for (int i = 0; i < iovcnt; ++i) {
+      const char *p = static_cast<const char *>(iov[i].iov_base);
+      buf.insert(buf.end(), p, p + iov[i].iov_len);
+    }
+    const char *t = reinterpret_cast<const char *>(&total);
+    buf.insert(buf.end(), t, t + sizeof(total));
+
+    leader = !shard.flush_pending;
+    shard.flush_pending = true;
+  }
+
+  if (leader)
+    return FlushShard(shard);
+  return CLStatus(0, 0);
+}
+
+CLStatus CLShardedWriter::FlushShard(Shard &shard) {
+  std::lock_guard<std::mutex> file_lock(shard.mutex_for_file);
+
+  {
+    std::lock_guard<std::mutex> lock(shard.mutex_for_write);
+    shard.write_buffer.swap(shard.flush_buffer);
+    shard.flush_pending = false;
+    if (shard.flush_buffer.empty())
+      return CLStatus(0, 0);
+  }
+
+  CLStatus s(0, 0);
+  const char *p = shard.flush_buffer.data();
+  size_t left = shard.flush_buffer.size();
+  while (left > 0) {
+    ssize_t n = write(shard.fd, p, left);
+    if (n == -1) {
+      if (errno == EINTR)
+        continue;
+      s = CLStatus(-1, errno);
+      break;
+    }
+    p += n;
+    left -= n;
+  }
+
+  // 写入失败时去掉写了一半的记录，之后的记录仍从完整的位置开始
+  uint64_t n = shard.flush_buffer.size();
+  if (s.IsSuccess())
+    shard.size += n;
+  else if (ftruncate(shard.fd, shard.size) == -1)
+    s = CLStatus(-1, errno);
+  shard.flush_buffer.clear();
+
+  // 写入期间追加的记录时间戳不小于原来的下界，写完后才更新
+  {
+    std::lock_guard<std::mutex> lock(shard.mutex_for_write);
+    shard.pending_min_ts.store(
+        shard.write_buffer.empty() ? IDLE_ : shard.buffer_min_ts);
+  }
+  if (s.IsSuccess())
+    notify_(n);
+  return s;
+}
+
+CLStatus CLShardedWriter::Flush() {
+  CLStatus result(0, 0);
+  for (auto &shard : shards_) {
+    CLStatus s = FlushShard(*shard);
+    if (!s.IsSuccess() && result.IsSuccess())
+      result = s;
+  }
+  return result;
+}
+
+CLStatus CLShardedWriter::Shutdown() {
+  // 没有后台线程，之后的写入仍由调用线程直接写入分片
+  return Flush();
+}
+
+CLStatus CLShardedWriter::Sync() {
+  for (auto &shard : shards_)
+    if (fdatasync(shard->fd) == -1)
+      return CLStatus(-1, errno);
+  return CLStatus(0, 0);
+}
+
+uint64_t CLShardedWriter::Watermark() {
+  // 不加锁：先取当前时间，之后才公布下界的记录时间戳不小于它；
+  // 已公布下界的分片取下界
+  uint64_t watermark = Now();
+  for (auto &shard : shards_)
+    watermark = std::min(watermark, shard->pending_min_ts.load());
+  return watermark;
+}
+
+// 从一个合并进度开始按（时间戳，分片，序号）依次取出各分片的记录
+class CLShardMerger::Merge {
+public:
+  struct Entry {
+    uint64_t ts;
+    uint32_t shard;
+    uint64_t seq;
+    uint32_t len;
+    bool operator>(const Entry &other) const {
+      if (ts != other.ts)
+        return ts > other.ts;
+      if (shard != other.shard)
+        return shard > other.shard;
+      return seq > other.seq;
+    }
+  };
+
+  Merge(const std::vector<int> &fds, const Cursor &from)
+      : cursor_(from), queued_(fds.size(), false), incomplete_(false) {
+    for (int fd : fds)
+      readers_.emplace_back(fd);
+    cursor_.pos.resize(fds.size(), 0);
+  }
+
+  // 读取尚未排队的分片的下一条记录，分片有新写入的记录后调用
+  void Refresh() {
+    incomplete_ = false;
+    for (uint32_t i = 0; i < readers_.size(); ++i)
+      if (!queued_[i])
+        Enqueue(i);
+  }
+
+  // 下一条记录，没有完整的记录时返回 false
+  bool Peek(Entry &entry) const {
+    if (heap_.empty())
+      return false;
+    entry = heap_.top();
+    return true;
+  }
+
+  void Pop() {
+    Entry entry = heap_.top();
+    heap_.pop();
+    queued_[entry.shard] = false;
+    cursor_.pos[entry.shard] += CLShardedWriter::RECORD_OVERHEAD_ + entry.len;
+    cursor_.offset += entry.len;
+    Enqueue(entry.shard);
+  }
+
+  // 复制下一条记录的消息中 [skip, skip + n) 的部分
+  bool CopyPayload(const Entry &entry, uint64_t skip, char *buf, size_t n) {
+    const char *p = readers_[entry.shard].Fetch(
+        cursor_.pos[entry.shard] + sizeof(CLShardRecordHeader) + skip, n);
+    if (p == nullptr)
+      return false;
+    memcpy(buf, p, n);
+    return true;
+  }
+
+  const Cursor &Position() const { return cursor_; }
+  bool Incomplete() const { return incomplete_; } // 有分片停在不完整的记录上
+
+private:
+  void Enqueue(uint32_t shard) {
+    CLShardRecordHeader header;
+    bool incomplete;
+    if (ReadRecord(readers_[shard], cursor_.pos[shard], shard, header,
+                   incomplete)) {
+      heap_.push({header.ts, shard, header.seq, header.len});
+      queued_[shard] = true;
+    } else if (incomplete) {
+      incomplete_ = true;
+    }
+  }
+
+  Cursor cursor_;
+  std::vector<CLShardReader> readers_;
+  std::vector<bool> queued_; // 分片的下一条记录是否在堆中
+  std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> heap_;
+  bool incomplete_;
+};
+
+CLShardMerger::CLShardMerger(const std::vector<std::string> &paths)
+    : checkpoint_bytes_(CHECKPOINT_BYTES_), file_bytes_(0), blocked_(true) {
+  for (const std::string &path : paths) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+      for (int opened : fds_)
+        close(opened);
+      throw "In CLShardMerger::CLShardMerger(), open error";
+    }
+    fds_.push_back(fd);
+  }
+
+  Cursor begin;
+  begin.pos.resize(fds_.size(), 0);
+  checkpoints_.push_back(begin);
+  frontier_.reset(new Merge(fds_, begin));
+}
+
+CLShardMerger::~CLShardMerger() {
+  reader_.reset();
+  frontier_.reset();
+  for (int fd : fds_)
+    close(fd);
+}
+
+uint64_t CLShardMerger::Advance(uint64_t watermark, uint64_t file_bytes) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (file_bytes == file_bytes_ && !blocked_)
+    return frontier_->Position().offset;
+  file_bytes_ = file_bytes;
+
+  // 时间戳小于水位的记录都已完整写入，不完整的记录一定不小于水位
+  frontier_->Refresh();
+  Merge::Entry entry;
+  bool blocked = false;
+  while (frontier_->Peek(entry)) {
+    if (entry.ts >= watermark) {
+      blocked = true;
+      break;
+    }
+    frontier_->Pop();
+    const Cursor &cursor = frontier_->Position();
+    if (cursor.offset - checkpoints_.back().offset >= checkpoint_bytes_) {
+      checkpoints_.push_back(cursor);
+      if (checkpoints_.size() > MAX_CHECKPOINTS_)
+        ThinCheckpoints();
+    }
+  }
+  blocked_ = blocked || frontier_->Incomplete();
+  return frontier_->Position().offset;
+}
+
+void CLShardMerger::ThinCheckpoints() {
+  // 每隔一个保留（保留日志开头），间隔加倍：数量有上限，
+  // 按偏移读取时最多从之前 checkpoint_bytes_ 处开始合并
+  size_t kept = 0;
+  for (size_t i = 0; i < checkpoints_.size(); i += 2)
+    checkpoints_[kept++] = std::move(checkpoints_[i]);
+  checkpoints_.resize(kept);
+  checkpoint_bytes_ *= 2;
+}
+
+CLStatus CLShardMerger::Read(uint64_t offset, char *buf, size_t len) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  uint64_t end = frontier_->Position().offset;
+  if (offset >= end || len == 0)
+    return CLStatus(0, 0);
+  len = std::min<uint64_t>(len, end - offset);
+
+  // 从 offset 之前最近的位置开始合并；顺序读取时接着上次的位置
+  auto checkpoint =
+      std::upper_bound(checkpoints_.begin(), checkpoints_.end(), offset,
+                       [](uint64_t off, const Cursor &c) {
+                         return off < c.offset;
+                       }) -
+      1;
+  if (!reader_ || reader_->Position().offset > offset ||
+      reader_->Position().offset < checkpoint->offset)
+    reader_.reset(new Merge(fds_, *checkpoint));
+  reader_->Refresh();
+
+  // 已合并部分之前的记录都已完整写入，读到 end 为止不会取到之后的记录
+  size_t copied = 0;
+  Merge::Entry entry;
+  while (copied < len && reader_->Peek(entry)) {
+    uint64_t record_begin = reader_->Position().offset;
+    uint64_t record_end = record_begin + entry.len;
+    uint64_t want = offset + copied;
+    if (record_end <= want) {
+      reader_->Pop();
+      continue;
+    }
+
+    size_t n = std::min<uint64_t>(record_end, offset + len) - want;
+    if (!reader_->CopyPayload(entry, want - record_begin, buf + copied, n))
+      break;
+    copied += n;
+    if (record_end <= offset + len)
+      reader_->Pop();
+  }
+
+  return CLStatus(copied, 0);
+}
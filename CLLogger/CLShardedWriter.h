@@ -0,0 +1,125 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <sys/uio.h>
+#include <vector>
+
+#include "CLLogWriter.h"
+
+// 分片日志中一条记录的头部，其后为消息内容与 4 字节的记录总长度，
+// 末尾的长度用于打开时从文件末尾向前校验最后一条记录是否完整
+struct CLShardRecordHeader {
+  uint64_t ts;    // 写入时间（纳秒），同一分片内不减
+  uint64_t seq;   // 分片内的序号
+  uint32_t shard; // 分片编号
+  uint32_t len;   // 消息长度
+};
+
+// 分片写入后端：每个 CPU 写入自己的分片文件 path.sK，分片之间不共享锁。
+// 每条消息带有时间戳与分片内序号，读取时由 CLShardMerger 按时间合并。
+// 分片内沿用同步模式的写法：追加到写缓存，缓存为空时追加的线程负责写入文件
+class CLShardedWriter : public CLLogWriter {
+public:
+  // 写入文件后的通知，参数为字节数
+  typedef std::function<void(uint64_t)> Notify;
+
+  // shards 为 0 时取 CPU 数；打开时去掉各分片末尾不完整的记录
+  CLShardedWriter(const std::string &path, size_t shards, Notify notify);
+  virtual ~CLShardedWriter();
+
+  virtual CLStatus Write(const struct iovec *iov, int iovcnt);
+  virtual CLStatus Flush();
+  virtual CLStatus Shutdown();
+
+  CLStatus Sync(); // 所有分片执行 fdatasync
+
+  // 时间戳小于返回值的记录都已完整写入文件，之后追加的记录时间戳都不小于它
+  uint64_t Watermark();
+
+  // 所有分片文件的路径，包括上次以更多分片运行时留下的
+  const std::vector<std::string> &ShardPaths() const { return paths_; }
+
+  static const size_t RECORD_OVERHEAD_; // 每条记录除消息外的字节数
+
+private:
+  CLShardedWriter(const CLShardedWriter &) = delete;
+  CLShardedWriter &operator=(const CLShardedWriter &) = delete;
+
+  struct Shard {
+    uint32_t index = 0;
+    int fd = -1;
+    uint64_t seq = 0;              // 下一条记录的序号
+    uint64_t size = 0;             // 已写入的字节数，写入失败时截断到这里
+    std::mutex mutex_for_write;    // 保护以下追加状态
+    std::vector<char> write_buffer; // 新记录追加到末尾
+    bool flush_pending = false;    // 写缓存是否已有线程负责写入
+    uint64_t buffer_min_ts = 0;    // 写缓存中第一条记录的时间戳
+    // 尚未写完的记录的时间戳下界，没有时为 IDLE_；读者不加锁读取
+    std::atomic<uint64_t> pending_min_ts{IDLE_};
+    std::mutex mutex_for_file;     // 串行化写文件
+    std::vector<char> flush_buffer; // 正在写入文件的缓存
+  };
+
+  uint64_t Now() const; // 单调时钟加上纪元偏移
+  // 校验分片末尾的记录，截断不完整的部分，取得最后一条记录的序号与时间戳
+  static CLStatus Recover(int fd, uint32_t index, uint64_t &size,
+                          uint64_t &next_seq, uint64_t &max_ts);
+  CLStatus FlushShard(Shard &shard);
+  Shard &LocalShard(); // 按当前 CPU 选择分片
+
+  Notify notify_;
+  std::vector<std::string> paths_;
+  std::vector<std::unique_ptr<Shard>> shards_;
+  int64_t epoch_; // 加到单调时钟上，使时间戳接近实时时钟且大于已有的记录
+
+  static const uint64_t IDLE_;
+};
+
+// 按时间戳合并各分片得到一个稳定的日志：只合并时间戳小于水位的记录，
+// 之后追加的记录都排在其后，已合并的部分不再变化，可以按偏移读取与缓存。
+// 记录按（时间戳，分片，序号）排序，偏移只计算消息内容；每合并一段记录
+// 一次各分片的读取位置，按偏移读取时从之前最近的位置重新合并
+class CLShardMerger {
+public:
+  explicit CLShardMerger(const std::vector<std::string> &paths);
+  ~CLShardMerger();
+
+  // 合并时间戳小于 watermark 的记录，返回合并后的日志长度；
+  // file_bytes 为各分片已写入的总字节数，与上次相同且上次已合并
+  // 文件中的全部记录时直接返回
+  uint64_t Advance(uint64_t watermark, uint64_t file_bytes);
+
+  // 从合并后的日志偏移 offset 处读取，返回值的 ReturnCode 为读取的字节数
+  CLStatus Read(uint64_t offset, char *buf, size_t len);
+
+private:
+  CLShardMerger(const CLShardMerger &) = delete;
+  CLShardMerger &operator=(const CLShardMerger &) = delete;
+
+  // 合并进度：合并后的偏移与各分片下一条记录的文件位置
+  struct Cursor {
+    uint64_t offset = 0;
+    std::vector<uint64_t> pos;
+  };
+  class Merge; // 从某个进度开始的一次合并
+
+  void ThinCheckpoints(); // 读取位置过多时减半，调用者持有 mutex_
+
+  std::vector<int> fds_;
+
+  std::mutex mutex_;                // 保护以下合并状态
+  std::vector<Cursor> checkpoints_; // 按偏移递增，第一个为日志开头
+  uint64_t checkpoint_bytes_;       // 当前记录读取位置的间隔
+  std::unique_ptr<Merge> frontier_; // 已合并部分的末尾
+  std::unique_ptr<Merge> reader_;   // 最近一次读取结束的位置
+  uint64_t file_bytes_;             // 上次合并时各分片已写入的字节数
+  bool blocked_; // 上次合并后文件中还有未合并的记录
+
+  static const uint64_t CHECKPOINT_BYTES_; // 记录读取位置的初始间隔
+  static const size_t MAX_CHECKPOINTS_;    // 保留的读取位置数上限
+};
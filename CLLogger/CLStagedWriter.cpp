@@ -0,0 +1,152 @@
+#include "CLStagedWriter.h"
+
+#include <chrono>
+
+std::atomic<uint64_t> CLStagedWriter::next_id_(1);
+
+// 线程局部缓存：最近使用的写入后端编号及其暂存缓冲区
+struct CLStagedLocal {
+  uint64_t id = 0;
+  std::shared_ptr<void> buffer;
+};
+static thread_local CLStagedLocal local_;
+
+CLStagedWriter::CLStagedWriter(Sink sink, size_t buffer_size,
+                               unsigned interval_ms)
+    : sink_(sink), buffer_size_(buffer_size), interval_ms_(interval_ms),
+      id_(next_id_.fetch_add(1)), closed_(false), error_code_(0) {
+  if (interval_ms_ != 0)
+    committer_ = std::thread(&CLStagedWriter::CommitterLoop, this);
+}
+
+CLStagedWriter::~CLStagedWriter() { Shutdown(); }
+
+CLStagedWriter::Buffer *CLStagedWriter::LocalBuffer() {
+  if (local_.id != id_) {
+    std::shared_ptr<Buffer> buffer = std::make_shared<Buffer>();
+    buffer->data.reserve(buffer_size_);
+    {
+      std::lock_guard<std::mutex> lock(mutex_for_buffers_);
+      buffers_.push_back(buffer);
+    }
+    local_.id = id_;
+    local_.buffer = buffer;
+  }
+  return static_cast<Buffer *>(local_.buffer.get());
+}
+
+CLStatus CLStagedWriter::Write(const struct iovec *iov, int iovcnt) {
+  // 已关闭：不再暂存，但要排在本线程之前暂存的消息之后写入，
+  // 因此与剩余的暂存消息一起提交
+  if (closed_.load(std::memory_order_acquire))
+    return Commit(iov, iovcnt);
+
+  Buffer *buffer = LocalBuffer();
+  bool full;
+  {
+    std::lock_guard<std::mutex> lock(buffer->mutex);
+    for (int i = 0; i < iovcnt; ++i) {
+      const char *p = static_cast<const char *>(iov[i].iov_base);
+      buffer->data.insert(buffer->data.end(), p, p + iov[i].iov_len);
+    }
+    full = buffer->data.size() >= buffer_size_;
+  }
+
+  // 缓冲区写满时由当前线程发起一次分组提交；
+  // 追加期间后端被关闭时也要提交，否则消息会留在缓冲区中
+  if (full || closed_.load(std::memory_order_acquire))
+    return Commit();
+  return CLStatus(0, 0);
+}
+
+CLStatus CLStagedWriter::Commit(const struct iovec *extra, int extracnt) {
+  std::lock_guard<std::mutex> commit_lock(mutex_for_commit_);
+
+  // 复制一份缓冲区列表，避免写文件期间阻塞新线程注册
+  std::vector<std::shared_ptr<Buffer>> buffers;
+  {
+    std::lock_guard<std::mutex> lock(mutex_for_buffers_);
+    buffers = buffers_;
+  }
+
+  // 逐个交换暂存缓冲区，所属线程随即可以继续追加
+  iov_.clear();
+  for (auto &buffer : buffers) {
+    std::lock_guard<std::mutex> lock(buffer->mutex);
+    buffer->data.swap(buffer->spare);
+    if (!buffer->spare.empty())
+      iov_.push_back({buffer->spare.data(), buffer->spare.size()});
+  }
+  iov_.insert(iov_.end(), extra, extra + extracnt);
+
+  CLStatus s(0, 0);
+  if (!iov_.empty())
+    s = sink_(iov_.data(), iov_.size());
+
+  // 引用者只剩 buffers_ 与本地副本时，所属线程已退出，移除其缓冲区
+  bool exited = false;
+  for (auto &buffer : buffers) {
+    buffer->spare.clear();
+    if (buffer.use_count() == 2)
+      exited = true;
+  }
+  buffers.clear();
+  if (exited) {
+    std::lock_guard<std::mutex> lock(mutex_for_buffers_);
+    for (size_t i = 0; i < buffers_.size();) {
+      bool empty;
+      {
+        std::lock_guard<std::mutex> buffer_lock(buffers_[i]->mutex);
+        empty = buffers_[i]->data.empty();
+      }
+      if (buffers_[i].use_count() == 1 && empty)
+        buffers_.erase(buffers_.begin() + i);
+      else
+        ++i;
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!s.IsSuccess())
+    error_code_ = s.ErrorCode();
+  return s;
+}
+
+CLStatus CLStagedWriter::Flush() {
+  CLStatus s = Commit();
+  if (!s.IsSuccess())
+    return s;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (error_code_ != 0)
+    return CLStatus(-1, error_code_);
+  return CLStatus(0, 0);
+}
+
+CLStatus CLStagedWriter::Shutdown() {
+  std::lock_guard<std::mutex> guard(mutex_for_shutdown_);
+  if (!closed_.load()) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      closed_.store(true, std::memory_order_release);
+    }
+    cv_.notify_one();
+    if (committer_.joinable())
+      committer_.join();
+  }
+
+  // 关闭后写入的消息随提交进入文件，这里提交剩余的暂存消息
+  return Flush();
+}
+
+void CLStagedWriter::CommitterLoop() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!closed_.load()) {
+    cv_.wait_for(lock, std::chrono::milliseconds(interval_ms_));
+    if (closed_.load())
+      break;
+    lock.unlock();
+    Commit();
+    lock.lock();
+  }
+}
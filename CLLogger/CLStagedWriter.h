@@ -0,0 +1,66 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <sys/uio.h>
+#include <thread>
+#include <vector>
+
+#include "CLLogWriter.h"
+
+// 分组提交写入后端：每个线程把消息追加到自己的暂存缓冲区，不经过共享锁；
+// 缓冲区写满、到达提交间隔或调用 Flush 时，把所有线程的缓冲区一次性
+// 用 writev 写入文件。同一线程的消息保持写入顺序
+class CLStagedWriter : public CLLogWriter {
+public:
+  // 将一组 iovec 完整写入文件的回调
+  typedef std::function<CLStatus(const struct iovec *, int)> Sink;
+
+  // buffer_size 为每个线程暂存缓冲区的提交阈值（字节），
+  // interval_ms 为后台定时提交的间隔，为 0 时不定时提交
+  CLStagedWriter(Sink sink, size_t buffer_size, unsigned interval_ms);
+  virtual ~CLStagedWriter();
+
+  virtual CLStatus Write(const struct iovec *iov, int iovcnt);
+  virtual CLStatus Flush();
+  virtual CLStatus Shutdown();
+
+private:
+  CLStagedWriter(const CLStagedWriter &) = delete;
+  CLStagedWriter &operator=(const CLStagedWriter &) = delete;
+
+  // 一个线程的暂存缓冲区；mutex 只在所属线程与提交线程之间竞争
+  struct Buffer {
+    std::mutex mutex;
+    std::vector<char> data;  // 所属线程追加消息
+    std::vector<char> spare; // 提交时与 data 交换后写入文件
+  };
+
+  Buffer *LocalBuffer(); // 当前线程的暂存缓冲区，首次调用时注册
+  // 提交所有线程的暂存缓冲区，extra 非空时在同一次写入中追加在其后
+  CLStatus Commit(const struct iovec *extra = nullptr, int extracnt = 0);
+  void CommitterLoop();
+
+  Sink sink_;
+  size_t buffer_size_;
+  unsigned interval_ms_;
+  uint64_t id_; // 区分不同的写入后端对象，用于线程局部缓存
+
+  std::mutex mutex_for_buffers_;                 // 保护 buffers_
+  std::vector<std::shared_ptr<Buffer>> buffers_; // 已注册的暂存缓冲区
+  std::mutex mutex_for_commit_;                  // 串行化提交
+  std::vector<struct iovec> iov_;                // 提交时使用，保留容量
+
+  std::thread committer_;
+  std::mutex mutex_;             // 配合条件变量使用
+  std::condition_variable cv_;   // 唤醒定时提交线程
+  std::atomic<bool> closed_;     // 已关闭，之后的消息随提交直接写入文件
+  long error_code_;              // 最近一次写入失败的 errno
+  std::mutex mutex_for_shutdown_; // 串行化 Shutdown
+
+  static std::atomic<uint64_t> next_id_;
+};
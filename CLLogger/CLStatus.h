@@ -16,6 +16,12 @@ public:
     error_code_ = s.error_code_;
   }
 
+  CLStatus &operator=(const CLStatus &s) {
+    return_code_ = s.return_code_;
+    error_code_ = s.error_code_;
+    return *this;
+  }
+
   virtual ~CLStatus(){};
 
   bool IsSuccess() {
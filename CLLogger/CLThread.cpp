@@ -1,10 +1,30 @@
 #include "CLThread.h"
+#include "CLWorkerPool.h"
 
-CLThread::CLThread() {}
+#include <sched.h>
+
+CLThread::CLThread() : status_(0, 0) {}
 CLThread::~CLThread() {}
 
+void CLThread::SetPooled(bool pooled) { pooled_ = pooled; }
+void CLThread::SetName(const std::string &name) { name_ = name; }
+void CLThread::SetAffinity(int cpu) { cpu_ = cpu; }
+
 CLStatus CLThread::Run() {
-  int r = pthread_create(&m_ThreadID, NULL, StartFunctionOfThread, this);
+  done_.store(false);
+  if (pooled_)
+    return CLWorkerPool::Instance()->Submit(this);
+
+  pthread_attr_t attr;
+  pthread_attr_init(&attr);
+  if (cpu_ >= 0) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu_, &set);
+    pthread_attr_setaffinity_np(&attr, sizeof(set), &set);
+  }
+  int r = pthread_create(&m_ThreadID, &attr, StartFunctionOfThread, this);
+  pthread_attr_destroy(&attr);
   if (r != 0)
     return CLStatus(-1, 0);
   return CLStatus(0, 0);
@@ -12,13 +32,41 @@ CLStatus CLThread::Run() {
 
 void *CLThread::StartFunctionOfThread(void *pThis) {
   CLThread *pThreadThis = (CLThread *)pThis;
-  CLStatus s = pThreadThis->RunThreadFunction();
-  return (void *)s.ReturnCode();
+  if (!pThreadThis->name_.empty())
+    pthread_setname_np(pthread_self(),
+                       pThreadThis->name_.substr(0, 15).c_str());
+  pThreadThis->Execute();
+  return 0;
+}
+
+void CLThread::Execute() {
+  status_ = RunThreadFunction();
+  if (pooled_)
+    Complete();
+}
+
+void CLThread::Complete() {
+  // 在锁内通知：等待者返回后可能立即销毁本对象
+  std::lock_guard<std::mutex> lock(mutex_for_done_);
+  done_.store(true, std::memory_order_release);
+  done_cv_.notify_all();
 }
 
 CLStatus CLThread::WaitForDeath() {
-  int r = pthread_join(m_ThreadID, 0);
-  if (r != 0)
-    return CLStatus(-1, 0);
-  return CLStatus(0, 0);
+  if (!pooled_) {
+    int r = pthread_join(m_ThreadID, 0);
+    if (r != 0)
+      return CLStatus(-1, 0);
+    return status_;
+  }
+
+  // 短任务很快结束，先自旋等待，避免睡眠与唤醒的开销
+  int spin = CLWorkerPool::SpinLimit();
+  for (int i = 0; i < spin && !done_.load(std::memory_order_acquire); ++i)
+    CLCpuRelax();
+
+  // 即使已看到结束标志也要获取一次锁，保证 Complete 已经释放锁
+  std::unique_lock<std::mutex> lock(mutex_for_done_);
+  done_cv_.wait(lock, [this] { return done_.load(); });
+  return status_;
 }
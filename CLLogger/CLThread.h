@@ -1,19 +1,43 @@
 #pragma once
 
 #include "CLStatus.h"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
 #include <pthread.h>
+#include <string>
 
 class CLThread {
 public:
   CLThread();
   virtual ~CLThread();
   CLStatus Run();
+  // 等待执行结束，返回 RunThreadFunction 的结果
   CLStatus WaitForDeath();
 
+  // 以下设置须在 Run 之前调用
+  void SetPooled(bool pooled); // 在常驻的工作线程上执行，不创建新线程
+  void SetName(const std::string &name); // 执行期间的线程名（最多 15 字节）
+  void SetAffinity(int cpu);             // 执行期间绑定到该 CPU，-1 为不绑定
+
 private:
+  friend class CLWorkerPool;
+
   static void *StartFunctionOfThread(void *);
+  void Execute();  // 在当前线程上执行并记录结果
+  void Complete(); // 通知等待者执行已结束
 
 protected:
   virtual CLStatus RunThreadFunction() = 0;
   pthread_t m_ThreadID;
+
+private:
+  bool pooled_ = false;
+  std::string name_;
+  int cpu_ = -1;
+
+  CLStatus status_;               // RunThreadFunction 的结果
+  std::atomic<bool> done_{false}; // 执行已结束
+  std::mutex mutex_for_done_;
+  std::condition_variable done_cv_;
 };
@@ -0,0 +1,111 @@
+#include "CLWorkerPool.h"
+
+#include <algorithm>
+#include <pthread.h>
+#include <sched.h>
+
+#include "CLThread.h"
+
+const int CLWorkerPool::SPIN_ITERATIONS_ = 4000;
+
+int CLWorkerPool::SpinLimit() {
+  static const int limit =
+      std::thread::hardware_concurrency() > 1 ? SPIN_ITERATIONS_ : 0;
+  return limit;
+}
+
+CLWorkerPool *CLWorkerPool::Instance() {
+  // 进程退出时析构，等待工作线程执行完已提交的任务
+  static CLWorkerPool pool(std::max(1u, std::thread::hardware_concurrency()));
+  return &pool;
+}
+
+CLWorkerPool::CLWorkerPool(size_t workers) {
+  for (size_t i = 0; i < workers; ++i)
+    workers_.emplace_back(&CLWorkerPool::WorkerLoop, this, i);
+}
+
+CLWorkerPool::~CLWorkerPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  cv_.notify_all();
+  for (auto &worker : workers_)
+    worker.join();
+}
+
+CLStatus CLWorkerPool::Submit(CLThread *task) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stop_)
+      return CLStatus(-1, 0);
+    tasks_.push_back(task);
+    pending_.fetch_add(1);
+  }
+  // 自旋中的工作线程会自行取走任务
+  if (sleeping_.load() != 0)
+    cv_.notify_one();
+  return CLStatus(0, 0);
+}
+
+CLThread *CLWorkerPool::TryPop() {
+  if (pending_.load(std::memory_order_relaxed) == 0)
+    return nullptr;
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (tasks_.empty())
+    return nullptr;
+  CLThread *task = tasks_.front();
+  tasks_.pop_front();
+  pending_.fetch_sub(1);
+  return task;
+}
+
+void CLWorkerPool::WorkerLoop(size_t index) {
+  std::string name = "cl-worker-" + std::to_string(index);
+  pthread_setname_np(pthread_self(), name.substr(0, 15).c_str());
+
+  while (true) {
+    CLThread *task = TryPop();
+    for (int i = 0; task == nullptr && i < SpinLimit(); ++i) {
+      CLCpuRelax();
+      task = TryPop();
+    }
+    if (task != nullptr) {
+      RunTask(task, name);
+      continue;
+    }
+
+    // 先登记再检查，提交者在入队之后检查登记数，不会漏掉唤醒
+    std::unique_lock<std::mutex> lock(mutex_);
+    sleeping_.fetch_add(1);
+    cv_.wait(lock, [this] { return stop_ || !tasks_.empty(); });
+    sleeping_.fetch_sub(1);
+    if (stop_ && tasks_.empty())
+      return;
+  }
+}
+
+void CLWorkerPool::RunTask(CLThread *task, const std::string &name) {
+  // 只有任务设置了线程名或 CPU 时才改变工作线程，执行后恢复
+  if (!task->name_.empty())
+    pthread_setname_np(pthread_self(), task->name_.substr(0, 15).c_str());
+  cpu_set_t saved;
+  bool pinned = false;
+  if (task->cpu_ >= 0 &&
+      pthread_getaffinity_np(pthread_self(), sizeof(saved), &saved) == 0) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(task->cpu_, &set);
+    pinned = pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+  }
+
+  bool renamed = !task->name_.empty();
+  // Execute 返回前通知等待者，之后不能再访问 task
+  task->Execute();
+
+  if (pinned)
+    pthread_setaffinity_np(pthread_self(), sizeof(saved), &saved);
+  if (renamed)
+    pthread_setname_np(pthread_self(), name.c_str());
+}
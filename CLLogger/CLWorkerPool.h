@@ -0,0 +1,55 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "CLStatus.h"
+
+class CLThread;
+
+// 自旋等待时提示 CPU，降低功耗并让出超线程的执行资源
+inline void CLCpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield");
+#endif
+}
+
+// 常驻工作线程池，执行以 SetPooled 设置的 CLThread 任务。
+// 工作线程取完任务后先自旋一小段时间再睡眠，连续提交的短任务
+// 不需要唤醒线程；只有存在睡眠的工作线程时提交才发出通知
+class CLWorkerPool {
+public:
+  static CLWorkerPool *Instance(); // 第一次调用时创建，线程数为 CPU 数
+
+  CLStatus Submit(CLThread *task);
+
+  // 等待任务时睡眠前的自旋次数；单核机器上自旋只会占用执行任务的 CPU，为 0
+  static int SpinLimit();
+
+private:
+  explicit CLWorkerPool(size_t workers);
+  CLWorkerPool(const CLWorkerPool &) = delete;
+  CLWorkerPool &operator=(const CLWorkerPool &) = delete;
+  ~CLWorkerPool();
+
+  CLThread *TryPop();
+  void WorkerLoop(size_t index);
+  void RunTask(CLThread *task, const std::string &name);
+
+  std::mutex mutex_;                // 保护 tasks_ 与 stop_
+  std::condition_variable cv_;      // 唤醒睡眠的工作线程
+  std::deque<CLThread *> tasks_;    // 等待执行的任务
+  std::atomic<size_t> pending_{0};  // tasks_ 的长度，自旋时无锁读取
+  std::atomic<int> sleeping_{0};    // 正在睡眠的工作线程数
+  bool stop_ = false;
+  std::vector<std::thread> workers_;
+
+  static const int SPIN_ITERATIONS_; // 多核机器上睡眠前的自旋次数
+};
@@ -0,0 +1,178 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "CLFileRW.h"
+
+// 持久化级别的基准测试：对每个级别分别启动一个子进程（CLFileRW 是单例，
+// 配置只能设置一次），多个线程并发调用 FileWrite，统计单次调用延迟的
+// 分位数和吞吐量
+
+struct BenchOptions {
+  std::string dir = "/tmp/cllogger_bench"; // 日志文件所在目录
+  std::string mode = "sync";               // 写入模式
+  int threads = 4;                         // 写入线程数
+  int messages = 20000;                    // 每个线程写入的消息条数
+  size_t size = 100;                       // 每条消息的字节数
+  unsigned interval_ms = 10;               // IntervalMs 级别的落盘间隔
+  size_t bytes = 1 << 20;                  // Bytes 级别的落盘阈值
+};
+
+static void Usage(const char *prog) {
+  fprintf(stderr,
+          "用法: %s [--dir 目录] [--mode sync|async|staged|mmap]\n"
+          "          [--threads N] [--messages N] [--size 字节]\n"
+          "          [--interval-ms N] [--bytes N]\n",
+          prog);
+}
+
+static CLWriteMode ParseMode(const std::string &mode) {
+  if (mode == "async")
+    return CLWriteMode::Async;
+  if (mode == "staged")
+    return CLWriteMode::Staged;
+  if (mode == "mmap")
+    return CLWriteMode::Mmap;
+  return CLWriteMode::Sync;
+}
+
+static const char *DurabilityName(CLDurability level) {
+  switch (level) {
+  case CLDurability::None:
+    return "none";
+  case CLDurability::IntervalMs:
+    return "interval";
+  case CLDurability::Bytes:
+    return "bytes";
+  case CLDurability::PerCommit:
+    return "per-commit";
+  }
+  return "";
+}
+
+// 在子进程中运行一个持久化级别，结果输出到标准输出
+static void RunLevel(const BenchOptions &opt, CLDurability level) {
+  CLFileRWConfig config;
+  config.mode = ParseMode(opt.mode);
+  config.durability = level;
+  config.sync_interval_ms = opt.interval_ms;
+  config.sync_bytes = opt.bytes;
+  CLFileRW::Configure(config);
+
+  std::string msg(opt.size - 1, 'x');
+  msg += '\n';
+
+  // 每个线程记录自己的延迟，结束后合并
+  std::vector<std::vector<uint32_t>> latencies(opt.threads);
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (int t = 0; t < opt.threads; ++t) {
+    threads.emplace_back([&, t]() {
+      std::vector<uint32_t> &lat = latencies[t];
+      lat.reserve(opt.messages);
+      for (int i = 0; i < opt.messages; ++i) {
+        auto begin = std::chrono::steady_clock::now();
+        CLFileRW::FileWrite(msg.data(), msg.size());
+        auto end = std::chrono::steady_clock::now();
+        lat.push_back(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin)
+                .count());
+      }
+    });
+  }
+  for (auto &thread : threads)
+    thread.join();
+  // 所有消息写入文件并落盘后才算结束
+  CLFileRW::GetInstance()->Sync();
+  double seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+
+  std::vector<uint32_t> all;
+  for (auto &lat : latencies)
+    all.insert(all.end(), lat.begin(), lat.end());
+  std::sort(all.begin(), all.end());
+  auto pct = [&](double p) {
+    size_t i = static_cast<size_t>(p * (all.size() - 1));
+    return all[i] / 1000.0;
+  };
+
+  printf("%-11s %12.0f %10.1f %10.1f %10.1f %10.1f\n", DurabilityName(level),
+         all.size() / seconds, pct(0.50), pct(0.99), pct(0.999),
+         all.back() / 1000.0);
+  fflush(stdout);
+}
+
+int main(int argc, char *argv[]) {
+  BenchOptions opt;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (i + 1 >= argc) {
+      Usage(argv[0]);
+      return 1;
+    }
+    std::string value = argv[++i];
+    if (arg == "--dir")
+      opt.dir = value;
+    else if (arg == "--mode")
+      opt.mode = value;
+    else if (arg == "--threads")
+      opt.threads = std::max(1, atoi(value.c_str()));
+    else if (arg == "--messages")
+      opt.messages = std::max(1, atoi(value.c_str()));
+    else if (arg == "--size")
+      opt.size = std::max<size_t>(1, strtoull(value.c_str(), nullptr, 10));
+    else if (arg == "--interval-ms")
+      opt.interval_ms = std::max(1, atoi(value.c_str()));
+    else if (arg == "--bytes")
+      opt.bytes = strtoull(value.c_str(), nullptr, 10);
+    else {
+      Usage(argv[0]);
+      return 1;
+    }
+  }
+
+  // 日志文件名固定为当前目录下的 temp.txt
+  mkdir(opt.dir.c_str(), 0755);
+  if (chdir(opt.dir.c_str()) == -1) {
+    perror("chdir");
+    return 1;
+  }
+
+  printf("mode=%s threads=%d messages=%d size=%zu\n", opt.mode.c_str(),
+         opt.threads, opt.messages, opt.size);
+  printf("%-11s %12s %10s %10s %10s %10s\n", "durability", "msgs/s",
+         "p50(us)", "p99(us)", "p99.9(us)", "max(us)");
+  fflush(stdout);
+
+  const CLDurability levels[] = {CLDurability::None, CLDurability::IntervalMs,
+                                 CLDurability::Bytes, CLDurability::PerCommit};
+  for (CLDurability level : levels) {
+    unlink("temp.txt");
+    pid_t pid = fork();
+    if (pid == -1) {
+      perror("fork");
+      return 1;
+    }
+    if (pid == 0) {
+      RunLevel(opt, level);
+      exit(0); // 运行静态析构，关闭文件操作对象
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+      fprintf(stderr, "%s: 子进程异常退出\n", DurabilityName(level));
+  }
+  unlink("temp.txt");
+
+  return 0;
+}
@@ -0,0 +1,116 @@
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <set>
+#include <string>
+#include <sys/stat.h>
+#include <vector>
+#include <zlib.h>
+
+#include "CLLogDecoder.h"
+#include "CLShardedWriter.h"
+
+// 分片文件 path.sK 返回 true，并取得 path
+static bool ShardBase(const std::string &name, std::string &base) {
+  size_t dot = name.rfind(".s");
+  if (dot == std::string::npos || dot + 2 == name.size() ||
+      name.find_first_not_of("0123456789", dot + 2) != std::string::npos)
+    return false;
+  base = name.substr(0, dot);
+  return true;
+}
+
+// 按时间戳合并 base 的全部分片后解码，各分片单独解码会得到乱码
+static int DecodeShards(const std::string &base, CLLogDecoder &decoder,
+                        std::string &out) {
+  // 与 CLShardedWriter 一样，从 s0 开始取到第一个不存在的分片为止
+  std::vector<std::string> paths;
+  uint64_t file_bytes = 0;
+  struct stat st;
+  for (size_t i = 0;; ++i) {
+    std::string path = base + ".s" + std::to_string(i);
+    if (stat(path.c_str(), &st) == -1)
+      break;
+    paths.push_back(path);
+    file_bytes += st.st_size;
+  }
+  if (paths.empty()) {
+    fprintf(stderr, "%s.s0: %s\n", base.c_str(), strerror(errno));
+    return 1;
+  }
+
+  try {
+    CLShardMerger merger(paths);
+    // 文件不再写入，合并全部完整的记录
+    uint64_t end = merger.Advance(UINT64_MAX, file_bytes);
+    char buf[1 << 16];
+    for (uint64_t offset = 0; offset < end;) {
+      CLStatus s = merger.Read(offset, buf, sizeof(buf));
+      if (!s.IsSuccess()) {
+        fprintf(stderr, "%s: %s\n", base.c_str(), strerror(s.ErrorCode()));
+        return 1;
+      }
+      if (s.ReturnCode() == 0)
+        break;
+      decoder.Feed(buf, s.ReturnCode(), out);
+      fwrite(out.data(), 1, out.size(), stdout);
+      out.clear();
+      offset += s.ReturnCode();
+    }
+  } catch (const char *) {
+    fprintf(stderr, "%s: cannot open shard files\n", base.c_str());
+    return 1;
+  }
+  return 0;
+}
+
+// 把结构化二进制日志还原为文本输出到标准输出。
+// 参数为按顺序排列的日志段（如 temp.txt.1.gz temp.txt.2 temp.txt），
+// 压缩与未压缩的段都可以直接读取。分片模式的文件（temp.txt.s0 ...）
+// 给出其中任意一个即可，同一组的全部分片按时间戳合并后解码一次
+int main(int argc, char *argv[]) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s LOG...\n", argv[0]);
+    return 2;
+  }
+
+  CLLogDecoder decoder;
+  std::string out;
+  char buf[1 << 16];
+  int status = 0;
+  std::set<std::string> decoded_shards;
+  for (int i = 1; i < argc; ++i) {
+    std::string base;
+    if (ShardBase(argv[i], base)) {
+      if (decoded_shards.insert(base).second &&
+          DecodeShards(base, decoder, out) != 0)
+        status = 1;
+      continue;
+    }
+
+    gzFile in = gzopen(argv[i], "rb");
+    if (in == nullptr) {
+      fprintf(stderr, "%s: %s\n", argv[i], strerror(errno));
+      status = 1;
+      continue;
+    }
+
+    int n;
+    while ((n = gzread(in, buf, sizeof(buf))) > 0) {
+      decoder.Feed(buf, n, out);
+      fwrite(out.data(), 1, out.size(), stdout);
+      out.clear();
+    }
+    if (n < 0) {
+      int err;
+      fprintf(stderr, "%s: %s\n", argv[i], gzerror(in, &err));
+      status = 1;
+    }
+    gzclose(in);
+  }
+
+  decoder.Finish(out);
+  fwrite(out.data(), 1, out.size(), stdout);
+  return status;
+}
@@ -0,0 +1,67 @@
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "CLAsyncWriter.h"
+
+// 把崩溃进程的共享环形缓冲区中尚未写出的消息追加到日志并清空缓冲区。
+// RING 为 ring_path 配置的共享内存名（如 /cllogger）或文件路径，
+// LOG 为当前段的路径；缓冲区仍被运行中的进程持有时不做任何操作
+int main(int argc, char *argv[]) {
+  if (argc != 3) {
+    fprintf(stderr, "usage: %s RING LOG\n", argv[0]);
+    return 2;
+  }
+
+  int fd = open(argv[2], O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+  if (fd == -1) {
+    fprintf(stderr, "%s: %s\n", argv[2], strerror(errno));
+    return 1;
+  }
+
+  auto sink = [fd](const struct iovec *iov, int iovcnt) {
+    // writev 可能只写入一部分，跳过已写完的缓冲区后继续写
+    struct iovec rest[IOV_MAX];
+    memcpy(rest, iov, iovcnt * sizeof(struct iovec));
+    int first = 0;
+    while (first < iovcnt) {
+      ssize_t n = writev(fd, &rest[first], iovcnt - first);
+      if (n == -1) {
+        if (errno == EINTR)
+          continue;
+        return CLStatus(-1, errno);
+      }
+      while (first < iovcnt && (size_t)n >= rest[first].iov_len) {
+        n -= rest[first].iov_len;
+        ++first;
+      }
+      if (first < iovcnt) {
+        rest[first].iov_base = (char *)rest[first].iov_base + n;
+        rest[first].iov_len -= n;
+      }
+    }
+    return CLStatus(0, 0);
+  };
+
+  CLStatus s = CLAsyncWriter::Recover(argv[1], sink);
+  if (!s.IsSuccess()) {
+    fprintf(stderr, "%s: %s\n", argv[1],
+            s.ErrorCode() == EWOULDBLOCK ? "in use by a running process"
+                                         : strerror(s.ErrorCode()));
+    close(fd);
+    return 1;
+  }
+  if (fsync(fd) == -1) {
+    fprintf(stderr, "%s: %s\n", argv[2], strerror(errno));
+    close(fd);
+    return 1;
+  }
+  close(fd);
+
+  printf("recovered %ld messages\n", s.ReturnCode());
+  return 0;
+}
@@ -0,0 +1,294 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "CLBinaryLog.h"
+#include "CLFileRW.h"
+
+// 日志写入的基准测试：对每种写入模式、线程数与消息大小的组合分别启动
+// 一个子进程（CLFileRW 是单例，配置只能设置一次），多个线程并发写入，
+// 可同时运行按随机偏移读取的读线程。统计吞吐量与单次调用延迟的分位数
+
+struct BenchOptions {
+  std::string dir = "/tmp/cllogger_bench";   // 日志文件所在目录
+  std::vector<std::string> modes = {"sync", "async", "staged", "mmap",
+                                     "sharded"};
+  std::vector<int> threads = {1, 4, 16, 64}; // 写入线程数
+  std::vector<size_t> sizes = {100};          // 每条消息的字节数
+  int messages = 20000;                       // 每个线程写入的消息条数
+  std::string api = "text";                   // text 或 binary
+  int readers = 0;                            // 读线程数
+  size_t read_size = 4096;                    // 每次读取的字节数
+};
+
+// 一次运行的延迟统计（微秒）
+struct LatencyStats {
+  size_t count = 0;
+  double p50 = 0, p99 = 0, p999 = 0, max = 0;
+};
+
+static void Usage(const char *prog) {
+  fprintf(stderr,
+          "用法: %s [--dir 目录] [--modes sync,async,staged,mmap,sharded]\n"
+          "          [--threads 1,4,16,64] [--sizes 100,1000]\n"
+          "          [--messages N] [--api text|binary]\n"
+          "          [--readers N] [--read-size 字节]\n",
+          prog);
+}
+
+static std::vector<std::string> SplitList(const std::string &value) {
+  std::vector<std::string> items;
+  size_t begin = 0;
+  while (begin <= value.size()) {
+    size_t end = value.find(',', begin);
+    if (end == std::string::npos)
+      end = value.size();
+    if (end > begin)
+      items.push_back(value.substr(begin, end - begin));
+    begin = end + 1;
+  }
+  return items;
+}
+
+static bool ParseMode(const std::string &mode, CLWriteMode &result) {
+  if (mode == "sync")
+    result = CLWriteMode::Sync;
+  else if (mode == "async")
+    result = CLWriteMode::Async;
+  else if (mode == "staged")
+    result = CLWriteMode::Staged;
+  else if (mode == "mmap")
+    result = CLWriteMode::Mmap;
+  else if (mode == "sharded")
+    result = CLWriteMode::Sharded;
+  else
+    return false;
+  return true;
+}
+
+// 删除上一次运行留下的日志与分片文件
+static void RemoveLogs() {
+  unlink("bench.log");
+  for (int i = 0; unlink(("bench.log.s" + std::to_string(i)).c_str()) == 0; ++i)
+    ;
+}
+
+// 合并各线程的延迟并计算分位数
+static LatencyStats Summarize(std::vector<std::vector<uint32_t>> &latencies) {
+  std::vector<uint32_t> all;
+  for (auto &lat : latencies)
+    all.insert(all.end(), lat.begin(), lat.end());
+  LatencyStats stats;
+  if (all.empty())
+    return stats;
+
+  std::sort(all.begin(), all.end());
+  auto pct = [&](double p) {
+    size_t i = static_cast<size_t>(p * (all.size() - 1));
+    return all[i] / 1000.0;
+  };
+  stats.count = all.size();
+  stats.p50 = pct(0.50);
+  stats.p99 = pct(0.99);
+  stats.p999 = pct(0.999);
+  stats.max = all.back() / 1000.0;
+  return stats;
+}
+
+// 在子进程中运行一个组合，结果输出到标准输出
+static void RunOne(const BenchOptions &opt, const std::string &mode,
+                   int nthreads, size_t size) {
+  CLFileRWConfig config;
+  ParseMode(mode, config.mode);
+  config.path = "bench.log";
+  CLFileRW::Configure(config);
+  std::shared_ptr<CLFileRW> file = CLFileRW::GetInstance();
+
+  std::string msg(size - 1, 'x');
+  msg += '\n';
+  bool binary = opt.api == "binary";
+  CLLogThreshold::Set(CLLogLevel::Info);
+
+  std::atomic<uint64_t> written(0);
+  std::atomic<bool> done(false);
+
+  // 读线程在已写入部分的前一半内随机读取，大多命中已稳定的内容，
+  // 不会频繁触发写缓存的写出
+  std::vector<std::vector<uint32_t>> read_latencies(opt.readers);
+  std::vector<std::thread> readers;
+  for (int r = 0; r < opt.readers; ++r) {
+    readers.emplace_back([&, r]() {
+      std::vector<uint32_t> &lat = read_latencies[r];
+      std::vector<char> buf(opt.read_size);
+      std::mt19937_64 rng(r + 1);
+      while (!done.load(std::memory_order_relaxed)) {
+        uint64_t limit = written.load(std::memory_order_relaxed) / 2;
+        if (limit == 0) {
+          std::this_thread::yield();
+          continue;
+        }
+        uint64_t offset = rng() % limit;
+        auto begin = std::chrono::steady_clock::now();
+        file->FRead(offset, buf.data(), buf.size());
+        auto end = std::chrono::steady_clock::now();
+        lat.push_back(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin)
+                .count());
+      }
+    });
+  }
+
+  // 每个线程记录自己的延迟，结束后合并
+  std::vector<std::vector<uint32_t>> latencies(nthreads);
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (int t = 0; t < nthreads; ++t) {
+    threads.emplace_back([&, t]() {
+      std::vector<uint32_t> &lat = latencies[t];
+      lat.reserve(opt.messages);
+      for (int i = 0; i < opt.messages; ++i) {
+        auto begin = std::chrono::steady_clock::now();
+        if (binary)
+          CL_LOG(Info, "%s", msg.c_str());
+        else
+          CLFileRW::FileWrite(msg.data(), msg.size());
+        auto end = std::chrono::steady_clock::now();
+        lat.push_back(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin)
+                .count());
+        written.fetch_add(msg.size(), std::memory_order_relaxed);
+      }
+    });
+  }
+  for (auto &thread : threads)
+    thread.join();
+  // 所有消息写入文件后才算结束
+  file->Flush();
+  double seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+  done.store(true);
+  for (auto &reader : readers)
+    reader.join();
+
+  LatencyStats w = Summarize(latencies);
+  printf("%-7s %7d %7zu %12.0f %9.1f %9.2f %9.2f %9.2f %9.1f", mode.c_str(),
+         nthreads, size, w.count / seconds,
+         w.count * size / seconds / (1 << 20), w.p50, w.p99, w.p999, w.max);
+  if (opt.readers > 0) {
+    LatencyStats r = Summarize(read_latencies);
+    CLCacheStats cache = file->CacheStats();
+    double hit = cache.hits + cache.misses == 0
+                     ? 0
+                     : 100.0 * cache.hits / (cache.hits + cache.misses);
+    printf(" %10.0f %9.2f %9.2f %6.1f%%", r.count / seconds, r.p50, r.p99,
+           hit);
+  }
+  printf("\n");
+  fflush(stdout);
+
+  file->Shutdown();
+}
+
+int main(int argc, char *argv[]) {
+  BenchOptions opt;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (i + 1 >= argc) {
+      Usage(argv[0]);
+      return 1;
+    }
+    std::string value = argv[++i];
+    if (arg == "--dir") {
+      opt.dir = value;
+    } else if (arg == "--modes") {
+      opt.modes = SplitList(value);
+    } else if (arg == "--threads") {
+      opt.threads.clear();
+      for (const std::string &item : SplitList(value))
+        opt.threads.push_back(std::min(64, std::max(1, atoi(item.c_str()))));
+    } else if (arg == "--sizes") {
+      opt.sizes.clear();
+      for (const std::string &item : SplitList(value))
+        opt.sizes.push_back(
+            std::max<size_t>(1, strtoull(item.c_str(), nullptr, 10)));
+    } else if (arg == "--messages") {
+      opt.messages = std::max(1, atoi(value.c_str()));
+    } else if (arg == "--api") {
+      opt.api = value;
+    } else if (arg == "--readers") {
+      opt.readers = std::max(0, atoi(value.c_str()));
+    } else if (arg == "--read-size") {
+      opt.read_size = std::max<size_t>(1, strtoull(value.c_str(), nullptr, 10));
+    } else {
+      Usage(argv[0]);
+      return 1;
+    }
+  }
+
+  CLWriteMode unused;
+  for (const std::string &mode : opt.modes) {
+    if (!ParseMode(mode, unused)) {
+      fprintf(stderr, "未知的写入模式: %s\n", mode.c_str());
+      return 1;
+    }
+  }
+  if (opt.api != "text" && opt.api != "binary") {
+    Usage(argv[0]);
+    return 1;
+  }
+
+  mkdir(opt.dir.c_str(), 0755);
+  if (chdir(opt.dir.c_str()) == -1) {
+    perror("chdir");
+    return 1;
+  }
+
+  printf("api=%s messages=%d readers=%d read-size=%zu\n", opt.api.c_str(),
+         opt.messages, opt.readers, opt.read_size);
+  printf("%-7s %7s %7s %12s %9s %9s %9s %9s %9s", "mode", "threads", "size",
+         "msgs/s", "MB/s", "p50(us)", "p99(us)", "p99.9(us)", "max(us)");
+  if (opt.readers > 0)
+    printf(" %10s %9s %9s %7s", "reads/s", "r-p50", "r-p99", "hit");
+  printf("\n");
+  fflush(stdout);
+
+  int status = 0;
+  for (size_t size : opt.sizes) {
+    for (int nthreads : opt.threads) {
+      for (const std::string &mode : opt.modes) {
+        RemoveLogs();
+        pid_t pid = fork();
+        if (pid == -1) {
+          perror("fork");
+          return 1;
+        }
+        if (pid == 0) {
+          RunOne(opt, mode, nthreads, size);
+          exit(0); // 运行静态析构，关闭文件操作对象
+        }
+        int child = 0;
+        waitpid(pid, &child, 0);
+        if (!WIFEXITED(child) || WEXITSTATUS(child) != 0) {
+          fprintf(stderr, "%s/%d/%zu: 子进程异常退出\n", mode.c_str(),
+                  nthreads, size);
+          status = 1;
+        }
+      }
+    }
+  }
+  RemoveLogs();
+
+  return status;
+}
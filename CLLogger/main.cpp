@@ -1,15 +1,39 @@
+#include "CLFileRW.h"
 #include "CLRWThread.h"
 #include "CLThread.h"
 #include "unistd.h"
+#include <cstring>
 #include <memory>
 
-int main() {
+int main(int argc, char *argv[]) {
+  // 参数为 async 时使用异步写入后端，为 staged 时使用分组提交，
+  // 为 mmap 时使用内存映射追加写入，为 sharded 时按 CPU 分片写入，
+  // 默认为同步写入；
+  // 参数中有 pooled 时读写操作在常驻的工作线程上执行
+  CLFileRWConfig config;
+  bool pooled = false;
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "async") == 0)
+      config.mode = CLWriteMode::Async;
+    else if (strcmp(argv[i], "staged") == 0)
+      config.mode = CLWriteMode::Staged;
+    else if (strcmp(argv[i], "mmap") == 0)
+      config.mode = CLWriteMode::Mmap;
+    else if (strcmp(argv[i], "sharded") == 0)
+      config.mode = CLWriteMode::Sharded;
+    else if (strcmp(argv[i], "pooled") == 0)
+      pooled = true;
+  }
+  CLFileRW::Configure(config);
+
   char str[20] = "543210";
   char str1[20] = "zxcvbnm";
   std::shared_ptr<CLThread> wThread(new CLWriteThread(str));
   std::shared_ptr<CLThread> wThread1(new CLWriteThread(str1));
   std::shared_ptr<CLThread> rThread(new CLReadThread(6));
   std::shared_ptr<CLThread> rThread1(new CLReadThread(9));
+  for (auto &thread : {wThread, wThread1, rThread, rThread1})
+    thread->SetPooled(pooled);
 
   wThread->Run();
   sleep(1); // 先确保文件中已有数据，之后三个操作并行执行
@@ -0,0 +1,343 @@
+#include "DirectoryScanner.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <memory>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// statx 只请求列表输出、磁盘用量统计与快照需要的字段
+static const unsigned STATX_FIELDS = STATX_TYPE | STATX_MODE | STATX_NLINK |
+                                     STATX_UID | STATX_GID | STATX_SIZE |
+                                     STATX_MTIME | STATX_CTIME | STATX_BLOCKS |
+                                     STATX_INO;
+static const int STATX_FLAGS = AT_SYMLINK_NOFOLLOW | AT_NO_AUTOMOUNT;
+
+static std::atomic<bool> uringEnabled(true); // 关闭或初始化失败后不再使用
+static std::atomic<bool> statxMissing(false); // 内核不支持 statx 时改用 fstatat
+
+// getdents64 返回的目录项格式
+struct LinuxDirent64 {
+  uint64_t d_ino;
+  int64_t d_off;
+  unsigned short d_reclen;
+  unsigned char d_type;
+  char d_name[];
+};
+
+static void fillFromStatx(DirectoryEntry &entry, const struct statx &stx) {
+  entry.mode = stx.stx_mode;
+  entry.links = stx.stx_nlink;
+  entry.uid = stx.stx_uid;
+  entry.gid = stx.stx_gid;
+  entry.size = stx.stx_size;
+  entry.modificationTime = stx.stx_mtime.tv_sec;
+  entry.modificationNsec = stx.stx_mtime.tv_nsec;
+  entry.changeTime = stx.stx_ctime.tv_sec;
+  entry.changeNsec = stx.stx_ctime.tv_nsec;
+  entry.blocks = stx.stx_blocks;
+  entry.dev = makedev(stx.stx_dev_major, stx.stx_dev_minor);
+  entry.ino = stx.stx_ino;
+}
+
+// 逐个取得一个目录项的元数据：优先 statx，内核不支持时用 fstatat
+static void statOne(int dirfd, DirectoryEntry &entry) {
+  if (!statxMissing.load(std::memory_order_relaxed)) {
+    struct statx stx;
+    if (statx(dirfd, entry.name.c_str(), STATX_FLAGS, STATX_FIELDS, &stx) ==
+        0) {
+      fillFromStatx(entry, stx);
+      return;
+    }
+    if (errno != ENOSYS) {
+      entry.error = errno;
+      return;
+    }
+    statxMissing.store(true);
+  }
+
+  struct stat st;
+  if (fstatat(dirfd, entry.name.c_str(), &st, AT_SYMLINK_NOFOLLOW) == -1) {
+    entry.error = errno;
+    return;
+  }
+  entry.mode = st.st_mode;
+  entry.links = st.st_nlink;
+  entry.uid = st.st_uid;
+  entry.gid = st.st_gid;
+  entry.size = st.st_size;
+  entry.modificationTime = st.st_mtim.tv_sec;
+  entry.modificationNsec = st.st_mtim.tv_nsec;
+  entry.changeTime = st.st_ctim.tv_sec;
+  entry.changeNsec = st.st_ctim.tv_nsec;
+  entry.blocks = st.st_blocks;
+  entry.dev = st.st_dev;
+  entry.ino = st.st_ino;
+}
+
+// 每个线程一个的 io_uring 实例，只用于成批提交 statx。
+// 直接使用系统调用与共享的提交、完成队列，不依赖 liburing
+class StatxRing {
+public:
+  explicit StatxRing(unsigned size) : fd(-1) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    fd = syscall(__NR_io_uring_setup, size, &params);
+    if (fd < 0)
+      return;
+
+    sqSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqSize = params.cq_off.cqes +
+             params.cq_entries * sizeof(struct io_uring_cqe);
+    bool single = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single)
+      sqSize = cqSize = std::max(sqSize, cqSize);
+    sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+
+    sqRing = mmap(nullptr, sqSize, PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    cqRing = single ? sqRing
+                    : mmap(nullptr, cqSize, PROT_READ | PROT_WRITE,
+                           MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+    void *sqeMap = mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    sqes = static_cast<struct io_uring_sqe *>(sqeMap);
+    if (sqRing == MAP_FAILED || cqRing == MAP_FAILED || sqeMap == MAP_FAILED) {
+      release();
+      return;
+    }
+
+    char *sq = static_cast<char *>(sqRing);
+    char *cq = static_cast<char *>(cqRing);
+    sqTail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+    sqMask = *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+    sqArray = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+    cqHead = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+    cqTail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+    cqMask = *reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+    cqes = reinterpret_cast<struct io_uring_cqe *>(cq + params.cq_off.cqes);
+    depth = params.sq_entries;
+
+    // 5.6 之前的内核没有 IORING_OP_STATX，也不支持探测，两种情况都不使用
+    if (!supportsStatx())
+      release();
+  }
+
+  ~StatxRing() { release(); }
+
+  bool ready() const { return fd >= 0; }
+
+  // 对 entries[begin, end) 提交 statx 并等待全部完成；
+  // 系统调用失败时返回 false，由调用者逐个处理
+  bool run(int dirfd, std::vector<DirectoryEntry> &entries, size_t begin,
+           size_t end, std::vector<struct statx> &results) {
+    unsigned count = end - begin;
+    unsigned tail = *sqTail;
+    for (unsigned i = 0; i < count; ++i) {
+      unsigned index = (tail + i) & sqMask;
+      struct io_uring_sqe *sqe = &sqes[index];
+      memset(sqe, 0, sizeof(*sqe));
+      sqe->opcode = IORING_OP_STATX;
+      sqe->fd = dirfd;
+      sqe->addr = reinterpret_cast<uint64_t>(entries[begin + i].name.c_str());
+      sqe->len = STATX_FIELDS;
+      sqe->off = reinterpret_cast<uint64_t>(&results[i]); // 即 addr2
+      sqe->statx_flags = STATX_FLAGS;
+      sqe->user_data = i;
+      sqArray[index] = index;
+    }
+    __atomic_store_n(sqTail, tail + count, __ATOMIC_RELEASE);
+
+    // 提交后等待完成；已提交的请求会写入 results，必须等它们全部完成
+    unsigned submitted = 0, completed = 0;
+    while (completed < count) {
+      int n = syscall(__NR_io_uring_enter, fd, count - submitted,
+                      count - completed, IORING_ENTER_GETEVENTS, nullptr, 0);
+      if (n >= 0) {
+        submitted += n;
+      } else if (errno != EINTR && submitted == 0) {
+        // 一个请求都没有被取走：关闭实例丢弃队列中的请求，由调用者逐个处理
+        release();
+        return false;
+      }
+      completed += reap(entries, begin, results);
+    }
+    if (unsupported) {
+      // 内核不支持 statx 请求：这一批的结果都不可用，由调用者逐个处理
+      release();
+      return false;
+    }
+    return true;
+  }
+
+  unsigned capacity() const { return depth; } // 一批最多提交的请求数
+
+private:
+  // 用 IORING_REGISTER_PROBE 查询内核是否支持 IORING_OP_STATX
+  bool supportsStatx() {
+    static const unsigned OPS = 256;
+    std::vector<char> buffer(sizeof(struct io_uring_probe) +
+                             OPS * sizeof(struct io_uring_probe_op));
+    struct io_uring_probe *probe =
+        reinterpret_cast<struct io_uring_probe *>(buffer.data());
+    if (syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe,
+                OPS) < 0)
+      return false;
+    return probe->last_op >= IORING_OP_STATX &&
+           (probe->ops[IORING_OP_STATX].flags & IO_URING_OP_SUPPORTED);
+  }
+
+  // 取出已完成的请求，返回条数
+  unsigned reap(std::vector<DirectoryEntry> &entries, size_t begin,
+                const std::vector<struct statx> &results) {
+    unsigned head = *cqHead;
+    unsigned reaped = 0;
+    while (head != __atomic_load_n(cqTail, __ATOMIC_ACQUIRE)) {
+      const struct io_uring_cqe &cqe = cqes[head & cqMask];
+      DirectoryEntry &entry = entries[begin + cqe.user_data];
+      // 在第一个成功的请求之前出现 EINVAL 或 EOPNOTSUPP，
+      // 说明内核不支持这种请求，而不是文件本身出错
+      if (cqe.res >= 0)
+        verified = true;
+      else if (!verified && (cqe.res == -EINVAL || cqe.res == -EOPNOTSUPP))
+        unsupported = true;
+      if (cqe.res < 0)
+        entry.error = -cqe.res;
+      else
+        fillFromStatx(entry, results[cqe.user_data]);
+      ++head;
+      ++reaped;
+    }
+    __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+    return reaped;
+  }
+
+  void release() {
+    if (sqes != nullptr && (void *)sqes != MAP_FAILED)
+      munmap(sqes, sqesSize);
+    if (cqRing != nullptr && cqRing != MAP_FAILED && cqRing != sqRing)
+      munmap(cqRing, cqSize);
+    if (sqRing != nullptr && sqRing != MAP_FAILED)
+      munmap(sqRing, sqSize);
+    sqes = nullptr;
+    sqRing = cqRing = nullptr;
+    if (fd >= 0)
+      close(fd);
+    fd = -1;
+  }
+
+  int fd;
+  void *sqRing = nullptr;
+  void *cqRing = nullptr;
+  struct io_uring_sqe *sqes = nullptr;
+  size_t sqSize = 0, cqSize = 0, sqesSize = 0;
+  unsigned *sqTail = nullptr, *sqArray = nullptr;
+  unsigned *cqHead = nullptr, *cqTail = nullptr;
+  struct io_uring_cqe *cqes = nullptr;
+  unsigned sqMask = 0, cqMask = 0;
+  unsigned depth = 0; // 提交队列的长度
+  bool verified = false;    // 已有请求成功完成，内核支持 statx 请求
+  bool unsupported = false; // 内核不支持 statx 请求
+};
+
+int DirectoryScanner::readEntries(int dirfd,
+                                  std::vector<DirectoryEntry> &entries) {
+  // 一次系统调用读取尽量多的目录项
+  static const size_t BUFFER_SIZE = 256 << 10;
+  std::unique_ptr<char[]> buffer(new char[BUFFER_SIZE]);
+
+  while (true) {
+    long n = syscall(SYS_getdents64, dirfd, buffer.get(), BUFFER_SIZE);
+    if (n == -1) {
+      if (errno == EINTR)
+        continue;
+      return errno;
+    }
+    if (n == 0)
+      return 0;
+
+    for (long pos = 0; pos < n;) {
+      const LinuxDirent64 *dirent =
+          reinterpret_cast<const LinuxDirent64 *>(buffer.get() + pos);
+      pos += dirent->d_reclen;
+      const char *name = dirent->d_name;
+      if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0)
+        continue; // 跳过 . 和 ..
+
+      DirectoryEntry entry;
+      entry.name = name;
+      entry.type = dirent->d_type;
+      entry.error = 0;
+      entry.mode = 0;
+      entry.links = 0;
+      entry.uid = 0;
+      entry.gid = 0;
+      entry.size = 0;
+      entry.modificationTime = 0;
+      entry.modificationNsec = 0;
+      entry.changeTime = 0;
+      entry.changeNsec = 0;
+      entry.blocks = 0;
+      entry.dev = 0;
+      entry.ino = dirent->d_ino;
+      entries.push_back(std::move(entry));
+    }
+  }
+}
+
+void DirectoryScanner::statEntries(int dirfd,
+                                   std::vector<DirectoryEntry> &entries) {
+  // 一个目录项时直接调用 statx，省去一次提交与唤醒
+  if (entries.size() > 1 && uringEnabled.load(std::memory_order_relaxed)) {
+    thread_local std::unique_ptr<StatxRing> ring;
+    if (!ring)
+      ring.reset(new StatxRing(128));
+    if (ring->ready()) {
+      std::vector<struct statx> results(ring->capacity());
+      size_t begin = 0;
+      while (begin < entries.size()) {
+        size_t end =
+            std::min<size_t>(begin + ring->capacity(), entries.size());
+        if (!ring->run(dirfd, entries, begin, end, results)) {
+          uringEnabled.store(false); // 其他线程也不再使用 io_uring
+          break;
+        }
+        begin = end;
+      }
+      if (begin == entries.size())
+        return;
+      // io_uring 出错：剩余的目录项逐个处理
+      for (size_t i = begin; i < entries.size(); ++i) {
+        entries[i].error = 0;
+        statOne(dirfd, entries[i]);
+      }
+      return;
+    }
+    uringEnabled.store(false); // 内核不支持或被禁用
+  }
+
+  for (DirectoryEntry &entry : entries)
+    statOne(dirfd, entry);
+}
+
+void DirectoryScanner::readLink(int dirfd, const std::string &name,
+                                std::string &target) {
+  char linkTarget[1024];
+  ssize_t len =
+      readlinkat(dirfd, name.c_str(), linkTarget, sizeof(linkTarget) - 1);
+  if (len == -1)
+    target.clear();
+  else
+    target.assign(linkTarget, len);
+}
+
+void DirectoryScanner::setUringEnabled(bool enabled) {
+  uringEnabled.store(enabled);
+}
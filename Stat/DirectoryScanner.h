@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+// 一个目录项及其元数据，元数据只取列表输出需要的字段
+struct DirectoryEntry {
+  std::string name;   // 文件名
+  unsigned char type; // getdents64 给出的类型（DT_*）
+  int error;          // 取元数据失败时的 errno，成功为 0
+  mode_t mode;        // 文件模式（类型和权限）
+  nlink_t links;      // 硬链接数
+  uid_t uid;
+  gid_t gid;
+  off_t size;
+  time_t modificationTime;
+  long modificationNsec; // 修改时间的纳秒部分
+  time_t changeTime;     // 状态改变时间（ctime）
+  long changeNsec;
+  blkcnt_t blocks; // 占用的 512 字节块数
+  dev_t dev;       // 所在设备，与 ino 一起识别硬链接
+  ino_t ino;
+  std::string linkTarget; // 符号链接的目标，由调用者按需填写
+};
+
+// 基于目录文件描述符的目录扫描：用大缓冲区的 getdents64 读取目录项，
+// 元数据按名字相对于目录取得（statx，只请求需要的字段），不拼接路径；
+// 内核支持 io_uring 时一个目录的 statx 请求成批提交，由内核并发执行
+class DirectoryScanner {
+public:
+  // 读取目录中的所有目录项（跳过 . 与 ..），顺序与 readdir 相同；
+  // 失败时返回 errno，成功返回 0
+  static int readEntries(int dirfd, std::vector<DirectoryEntry> &entries);
+
+  // 取得各目录项的元数据，不跟随符号链接
+  static void statEntries(int dirfd, std::vector<DirectoryEntry> &entries);
+
+  // 读取符号链接的目标到 target，失败时为空串；复用 target 已有的空间
+  static void readLink(int dirfd, const std::string &name,
+                       std::string &target);
+
+  static void setUringEnabled(bool enabled); // 关闭后总是逐个调用 statx
+};
@@ -0,0 +1,125 @@
+#include "IdNameCache.h"
+
+#include <cerrno>
+#include <grp.h>
+#include <mutex>
+#include <pwd.h>
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
+
+// 编号到名称的表：读多写少，用读写锁保护；
+// unordered_map 的元素地址在插入后不变，可以返回引用
+class NameTable {
+public:
+  typedef bool (*Lookup)(unsigned id, std::string &name);
+
+  explicit NameTable(Lookup lookup) : lookup(lookup) {}
+
+  const std::string &name(unsigned id) {
+    {
+      std::shared_lock<std::shared_mutex> lock(mutex);
+      auto it = names.find(id);
+      if (it != names.end())
+        return it->second;
+    }
+
+    // 查询名称服务时不持有锁；多个线程同时查同一编号时保留先插入的结果
+    std::string name;
+    if (!lookup(id, name))
+      name = std::to_string(id);
+    return insert(id, name);
+  }
+
+  // 加入一项，已有的不覆盖
+  const std::string &insert(unsigned id, const std::string &name) {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    return names.emplace(id, name).first->second;
+  }
+
+private:
+  Lookup lookup;
+  std::shared_mutex mutex;
+  std::unordered_map<unsigned, std::string> names;
+};
+
+// 缓冲区不够时加大重试的上限
+static const size_t MAX_BUFFER_SIZE = 1 << 20;
+
+static bool lookupUser(unsigned id, std::string &name) {
+  std::vector<char> buffer(4096);
+  while (true) {
+    struct passwd pwd, *result = nullptr;
+    int error = getpwuid_r(id, &pwd, buffer.data(), buffer.size(), &result);
+    if (error == ERANGE && buffer.size() < MAX_BUFFER_SIZE) {
+      buffer.resize(buffer.size() * 2);
+      continue;
+    }
+    if (error != 0 || result == nullptr)
+      return false;
+    name = result->pw_name;
+    return true;
+  }
+}
+
+static bool lookupGroup(unsigned id, std::string &name) {
+  std::vector<char> buffer(4096);
+  while (true) {
+    struct group grp, *result = nullptr;
+    int error = getgrgid_r(id, &grp, buffer.data(), buffer.size(), &result);
+    if (error == ERANGE && buffer.size() < MAX_BUFFER_SIZE) {
+      buffer.resize(buffer.size() * 2);
+      continue;
+    }
+    if (error != 0 || result == nullptr)
+      return false;
+    name = result->gr_name;
+    return true;
+  }
+}
+
+static NameTable users(lookupUser);
+static NameTable groups(lookupGroup);
+
+// 每个线程记住上一次的结果：同一目录树中的文件大多属于同一用户，
+// 命中时不需要加锁
+struct LastName {
+  unsigned id = 0;
+  const std::string *name = nullptr;
+};
+
+const std::string &IdNameCache::userName(uid_t uid) {
+  thread_local LastName last;
+  if (last.name == nullptr || last.id != uid) {
+    last.id = uid;
+    last.name = &users.name(uid);
+  }
+  return *last.name;
+}
+
+const std::string &IdNameCache::groupName(gid_t gid) {
+  thread_local LastName last;
+  if (last.name == nullptr || last.id != gid) {
+    last.id = gid;
+    last.name = &groups.name(gid);
+  }
+  return *last.name;
+}
+
+void IdNameCache::prefetch() {
+  // 同一编号出现多次时保留第一项，与 getpwuid 的结果一致
+  std::vector<char> buffer(MAX_BUFFER_SIZE);
+  struct passwd pwd, *pwdResult = nullptr;
+  setpwent();
+  while (getpwent_r(&pwd, buffer.data(), buffer.size(), &pwdResult) == 0 &&
+         pwdResult != nullptr)
+    users.insert(pwd.pw_uid, pwd.pw_name);
+  endpwent();
+
+  struct group grp, *grpResult = nullptr;
+  setgrent();
+  while (getgrent_r(&grp, buffer.data(), buffer.size(), &grpResult) == 0 &&
+         grpResult != nullptr)
+    groups.insert(grp.gr_gid, grp.gr_name);
+  endgrent();
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <string>
+#include <sys/types.h>
+
+// 用户与组编号到名称的缓存，可被多个线程同时使用。
+// 查不到的编号同样缓存（名称为编号本身），每个编号最多查询一次名称服务
+class IdNameCache {
+public:
+  // 用户名，查不到时为用户编号
+  static const std::string &userName(uid_t uid);
+
+  // 组名，查不到时为组编号
+  static const std::string &groupName(gid_t gid);
+
+  // 预先读入整个 passwd 与 group 数据库，应在遍历开始前调用
+  static void prefetch();
+};
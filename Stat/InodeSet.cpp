@@ -0,0 +1,9 @@
+#include "InodeSet.h"
+
+bool InodeSet::insert(dev_t dev, ino_t ino) {
+  Inode inode = {static_cast<uint64_t>(dev), static_cast<uint64_t>(ino)};
+  size_t hash = InodeHash()(inode);
+  Shard &shard = shards[(hash >> 32) % SHARDS]; // 段内用低位，选段用高位
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  return shard.inodes.insert(inode).second;
+}
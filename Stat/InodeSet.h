@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <sys/types.h>
+#include <unordered_set>
+
+// 已经统计过的文件（设备号与 inode 号），用于硬链接去重。
+// 按哈希分成多段，每段一把锁，可被多个线程同时使用
+class InodeSet {
+public:
+  // 第一次加入时返回 true
+  bool insert(dev_t dev, ino_t ino);
+
+private:
+  struct Inode {
+    uint64_t dev;
+    uint64_t ino;
+    bool operator==(const Inode &other) const {
+      return dev == other.dev && ino == other.ino;
+    }
+  };
+
+  struct InodeHash {
+    size_t operator()(const Inode &inode) const {
+      return std::hash<uint64_t>()(inode.ino * 0x9e3779b97f4a7c15ULL ^
+                                   inode.dev);
+    }
+  };
+
+  static const size_t SHARDS = 64;
+
+  struct Shard {
+    std::mutex mutex;
+    std::unordered_set<Inode, InodeHash> inodes;
+  };
+
+  Shard shards[SHARDS];
+};
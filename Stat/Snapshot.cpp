@@ -0,0 +1,337 @@
+#include "Snapshot.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+static const char MAGIC[8] = {'S', 'T', 'A', 'T', 'S', 'N', 'A', 'P'};
+static const uint32_t VERSION = 1;
+
+// 上次读目录之后这段时间内的修改可能与读取时的时间戳相同
+static const int64_t TIMESTAMP_GRANULARITY = 1000000000;
+
+static_assert(sizeof(SnapshotHeader) % 8 == 0, "header must stay aligned");
+static_assert(sizeof(SnapshotEntry) == 56, "entry layout changed");
+static_assert(sizeof(SnapshotDirectory) == 64, "directory layout changed");
+
+static uint64_t alignUp(uint64_t value) { return (value + 7) & ~uint64_t(7); }
+
+static int64_t nanoseconds(int64_t seconds, uint32_t nsec) {
+  return seconds * 1000000000 + nsec;
+}
+
+DirectoryStamp DirectoryStamp::fromEntry(const DirectoryEntry &entry) {
+  DirectoryStamp stamp;
+  stamp.dev = entry.dev;
+  stamp.ino = entry.ino;
+  stamp.modificationTime = entry.modificationTime;
+  stamp.modificationNsec = entry.modificationNsec;
+  stamp.changeTime = entry.changeTime;
+  stamp.changeNsec = entry.changeNsec;
+  return stamp;
+}
+
+DirectoryStamp DirectoryStamp::fromStat(const struct stat &st) {
+  DirectoryStamp stamp;
+  stamp.dev = st.st_dev;
+  stamp.ino = st.st_ino;
+  stamp.modificationTime = st.st_mtim.tv_sec;
+  stamp.modificationNsec = st.st_mtim.tv_nsec;
+  stamp.changeTime = st.st_ctim.tv_sec;
+  stamp.changeNsec = st.st_ctim.tv_nsec;
+  return stamp;
+}
+
+SnapshotReader::SnapshotReader()
+    : map(MAP_FAILED), mapSize(0), header(nullptr), entryRecords(nullptr),
+      directories(nullptr), names(nullptr) {}
+
+SnapshotReader::~SnapshotReader() {
+  if (map != MAP_FAILED)
+    munmap(map, mapSize);
+}
+
+bool SnapshotReader::open(const std::string &file) {
+  int fd = ::open(file.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd == -1)
+    return false;
+  struct stat st;
+  if (fstat(fd, &st) == -1 || st.st_size < (off_t)sizeof(SnapshotHeader)) {
+    close(fd);
+    return false;
+  }
+  mapSize = st.st_size;
+  map = mmap(nullptr, mapSize, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED)
+    return false;
+
+  const char *base = static_cast<const char *>(map);
+  header = reinterpret_cast<const SnapshotHeader *>(base);
+  if (!validate()) {
+    munmap(map, mapSize);
+    map = MAP_FAILED;
+    return false;
+  }
+  entryRecords =
+      reinterpret_cast<const SnapshotEntry *>(base + header->entriesOffset);
+  directories = reinterpret_cast<const SnapshotDirectory *>(
+      base + header->directoriesOffset);
+  names = base + header->namesOffset;
+
+  // 按父目录分组；目录按先序排列，组内保持原来的顺序
+  size_t count = header->directoryCount;
+  childStart.assign(count + 1, 0);
+  for (size_t i = 1; i < count; ++i)
+    ++childStart[directories[i].parent + 1];
+  for (size_t i = 0; i < count; ++i)
+    childStart[i + 1] += childStart[i];
+  childList.resize(count > 0 ? count - 1 : 0);
+  std::vector<uint32_t> next(childStart.begin(), childStart.end() - 1);
+  for (size_t i = 1; i < count; ++i)
+    childList[next[directories[i].parent]++] = i;
+  return true;
+}
+
+// 检查各部分都在文件范围内，目录之间的引用有效
+bool SnapshotReader::validate() {
+  if (memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 ||
+      header->version != VERSION)
+    return false;
+  uint64_t size = mapSize;
+  if (header->entriesOffset != alignUp(sizeof(SnapshotHeader)) ||
+      header->entryCount > size / sizeof(SnapshotEntry) ||
+      header->directoriesOffset !=
+          header->entriesOffset + header->entryCount * sizeof(SnapshotEntry) ||
+      header->directoryCount > size / sizeof(SnapshotDirectory) ||
+      header->namesOffset != header->directoriesOffset +
+                                 header->directoryCount *
+                                     sizeof(SnapshotDirectory) ||
+      header->namesSize == 0 || header->namesSize > size ||
+      header->namesOffset + header->namesSize != size)
+    return false;
+
+  const char *base = static_cast<const char *>(map);
+  const char *nameTable = base + header->namesOffset;
+  if (nameTable[header->namesSize - 1] != '\0' ||
+      header->rootPath >= header->namesSize || header->directoryCount == 0)
+    return false;
+
+  const SnapshotDirectory *dirs = reinterpret_cast<const SnapshotDirectory *>(
+      base + header->directoriesOffset);
+  for (uint64_t i = 0; i < header->directoryCount; ++i) {
+    const SnapshotDirectory &dir = dirs[i];
+    if ((i == 0) != (dir.parent == NONE) || (i > 0 && dir.parent >= i) ||
+        (i > 0 && dir.name >= header->namesSize) ||
+        dir.firstEntry > header->entryCount ||
+        dir.entryCount > header->entryCount - dir.firstEntry)
+      return false;
+  }
+
+  // 目录项只在用到时读取，名字的偏移由 name() 检查
+  return true;
+}
+
+uint32_t SnapshotReader::root(const std::string &path) const {
+  if (header == nullptr || path != name(header->rootPath))
+    return NONE;
+  return 0;
+}
+
+bool SnapshotReader::unchanged(uint32_t directory,
+                               const DirectoryStamp &stamp) const {
+  const SnapshotDirectory &dir = directories[directory];
+  return dir.dev == stamp.dev && dir.ino == stamp.ino &&
+         dir.modificationTime == stamp.modificationTime &&
+         dir.modificationNsec == stamp.modificationNsec &&
+         dir.changeTime == stamp.changeTime &&
+         dir.changeNsec == stamp.changeNsec &&
+         nanoseconds(dir.changeTime, dir.changeNsec) <
+             header->scanTime - TIMESTAMP_GRANULARITY;
+}
+
+const SnapshotEntry *SnapshotReader::entries(uint32_t directory,
+                                             uint32_t &count) const {
+  count = directories[directory].entryCount;
+  return entryRecords + directories[directory].firstEntry;
+}
+
+void SnapshotReader::loadEntries(uint32_t directory,
+                                 std::vector<DirectoryEntry> &entries) const {
+  uint32_t count;
+  const SnapshotEntry *records = this->entries(directory, count);
+  entries.resize(count);
+  for (uint32_t i = 0; i < count; ++i) {
+    const SnapshotEntry &record = records[i];
+    DirectoryEntry &entry = entries[i];
+    entry.name = name(record.name);
+    entry.type = record.type;
+    entry.error = record.error;
+    entry.mode = record.mode;
+    entry.links = record.links;
+    entry.uid = record.uid;
+    entry.gid = record.gid;
+    entry.size = record.size;
+    entry.modificationTime = record.modificationTime;
+    entry.modificationNsec = record.modificationNsec;
+    entry.changeTime = 0;
+    entry.changeNsec = 0;
+    entry.blocks = 0;
+    entry.dev = 0;
+    entry.ino = 0;
+    if (record.linkTarget != NONE)
+      entry.linkTarget = name(record.linkTarget);
+    else
+      entry.linkTarget.clear();
+  }
+}
+
+uint32_t SnapshotReader::findChild(uint32_t directory, const char *childName,
+                                   size_t &cursor) const {
+  uint32_t begin = childStart[directory], end = childStart[directory + 1];
+  size_t count = end - begin;
+  for (size_t i = 0; i < count; ++i) {
+    size_t index = (cursor + i) % count;
+    uint32_t child = childList[begin + index];
+    if (strcmp(name(directories[child].name), childName) == 0) {
+      cursor = index + 1;
+      return child;
+    }
+  }
+  return NONE;
+}
+
+SnapshotWriter::SnapshotWriter() : fd(-1), writeError(0), entryCount(0) {}
+
+SnapshotWriter::~SnapshotWriter() {
+  if (fd >= 0) {
+    close(fd);
+    unlink(temporary.c_str());
+  }
+}
+
+int SnapshotWriter::open(const std::string &file, const std::string &rootPath,
+                         int64_t scanTime) {
+  this->file = file;
+  temporary = file + ".tmp";
+  fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+              0644);
+  if (fd == -1)
+    return errno;
+
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.version = VERSION;
+  header.scanTime = scanTime;
+  header.rootPath = intern(rootPath);
+
+  // 文件头最后写入，先留出位置
+  buffer.assign(alignUp(sizeof(SnapshotHeader)), '\0');
+  return 0;
+}
+
+uint32_t SnapshotWriter::intern(const std::string &name) {
+  auto it = nameOffsets.find(name);
+  if (it != nameOffsets.end())
+    return it->second;
+  uint32_t offset = names.size();
+  names.append(name.c_str(), name.size() + 1);
+  nameOffsets.emplace(name, offset);
+  return offset;
+}
+
+uint32_t SnapshotWriter::addDirectory(uint32_t parent, const std::string &name,
+                                      const DirectoryStamp &stamp, int error,
+                                      const std::vector<DirectoryEntry> &entries) {
+  SnapshotDirectory dir;
+  memset(&dir, 0, sizeof(dir));
+  dir.dev = stamp.dev;
+  dir.ino = stamp.ino;
+  dir.modificationTime = stamp.modificationTime;
+  dir.modificationNsec = stamp.modificationNsec;
+  dir.changeTime = stamp.changeTime;
+  dir.changeNsec = stamp.changeNsec;
+  dir.name = parent == SnapshotReader::NONE ? SnapshotReader::NONE
+                                            : intern(name);
+  dir.parent = parent;
+  dir.firstEntry = entryCount;
+  dir.entryCount = entries.size();
+  dir.error = error;
+  directories.push_back(dir);
+
+  for (const DirectoryEntry &entry : entries) {
+    SnapshotEntry record;
+    memset(&record, 0, sizeof(record));
+    record.name = intern(entry.name);
+    record.linkTarget = S_ISLNK(entry.mode) && !entry.linkTarget.empty()
+                            ? intern(entry.linkTarget)
+                            : SnapshotReader::NONE;
+    record.mode = entry.mode;
+    record.links = entry.links;
+    record.uid = entry.uid;
+    record.gid = entry.gid;
+    record.error = entry.error;
+    record.type = entry.type;
+    record.modificationNsec = entry.modificationNsec;
+    record.size = entry.size;
+    record.modificationTime = entry.modificationTime;
+    write(&record, sizeof(record));
+  }
+  entryCount += entries.size();
+  return directories.size() - 1;
+}
+
+void SnapshotWriter::write(const void *data, size_t length) {
+  buffer.append(static_cast<const char *>(data), length);
+  if (buffer.size() >= (1 << 20))
+    flush();
+}
+
+void SnapshotWriter::flush() {
+  const char *data = buffer.data();
+  size_t length = buffer.size();
+  while (length > 0 && writeError == 0) {
+    ssize_t n = ::write(fd, data, length);
+    if (n == -1) {
+      if (errno != EINTR)
+        writeError = errno;
+      continue;
+    }
+    data += n;
+    length -= n;
+  }
+  buffer.clear();
+}
+
+int SnapshotWriter::finish() {
+  header.entryCount = entryCount;
+  header.directoryCount = directories.size();
+  header.namesSize = names.size();
+  header.entriesOffset = alignUp(sizeof(SnapshotHeader));
+  header.directoriesOffset =
+      header.entriesOffset + entryCount * sizeof(SnapshotEntry);
+  header.namesOffset = header.directoriesOffset +
+                       directories.size() * sizeof(SnapshotDirectory);
+
+  write(directories.data(), directories.size() * sizeof(SnapshotDirectory));
+  write(names.data(), names.size());
+  flush();
+  if (writeError == 0 && pwrite(fd, &header, sizeof(header), 0) !=
+                             static_cast<ssize_t>(sizeof(header)))
+    writeError = errno;
+
+  // 写完整后再替换，中途失败时原来的快照保持不变
+  if (writeError == 0 && fdatasync(fd) == -1)
+    writeError = errno;
+  if (close(fd) == -1 && writeError == 0)
+    writeError = errno;
+  fd = -1;
+  if (writeError == 0 && rename(temporary.c_str(), file.c_str()) == -1)
+    writeError = errno;
+  if (writeError != 0)
+    unlink(temporary.c_str());
+  return writeError;
+}
@@ -0,0 +1,165 @@
+#pragma once
+
+#include <cstdint>
+#include <dirent.h>
+#include <string>
+#include <sys/stat.h>
+#include <unordered_map>
+#include <vector>
+
+#include "DirectoryScanner.h"
+
+// 目录的身份与时间戳。目录中增删、改名时 mtime 变化，
+// 权限等变化时 ctime 变化；都不变时目录项与上次相同
+struct DirectoryStamp {
+  uint64_t dev = 0;
+  uint64_t ino = 0;
+  int64_t modificationTime = 0;
+  int64_t changeTime = 0;
+  uint32_t modificationNsec = 0;
+  uint32_t changeNsec = 0;
+
+  static DirectoryStamp fromEntry(const DirectoryEntry &entry);
+  static DirectoryStamp fromStat(const struct stat &st);
+};
+
+// 快照文件的格式（本机字节序，各部分按 8 字节对齐）：
+//   SnapshotHeader | SnapshotEntry[entryCount] |
+//   SnapshotDirectory[directoryCount] | 名字表
+// 目录按先序排列，一个目录的目录项连续存放；名字表中的字符串以 '\0'
+// 结尾，相同的名字只存一份，记录中保存名字在表中的偏移
+struct SnapshotHeader {
+  char magic[8];             // "STATSNAP"
+  uint32_t version;
+  uint32_t rootPath;         // 根目录路径在名字表中的偏移
+  int64_t scanTime;          // 开始遍历的时间，单位纳秒
+  uint64_t entryCount;
+  uint64_t directoryCount;
+  uint64_t namesSize;
+  uint64_t entriesOffset;
+  uint64_t directoriesOffset;
+  uint64_t namesOffset;
+};
+
+struct SnapshotEntry {
+  uint32_t name;
+  uint32_t linkTarget;       // 不是符号链接或没有目标时为 NONE
+  uint32_t mode;
+  uint32_t links;
+  uint32_t uid;
+  uint32_t gid;
+  int32_t error;             // 取元数据失败时的 errno
+  uint8_t type;              // DT_*
+  uint8_t reserved[3];
+  uint32_t modificationNsec;
+  uint32_t reserved2;
+  int64_t size;
+  int64_t modificationTime;
+
+  // 与遍历时相同的条件：只有这样的目录项会进入子目录
+  bool isSubdirectory() const {
+    return error == 0 && S_ISDIR(mode) && type == DT_DIR;
+  }
+};
+
+struct SnapshotDirectory {
+  uint64_t dev;
+  uint64_t ino;
+  int64_t modificationTime;
+  int64_t changeTime;
+  uint32_t modificationNsec;
+  uint32_t changeNsec;
+  uint32_t name;             // 目录名；根目录为 NONE，路径见文件头
+  uint32_t parent;           // 父目录的编号，根目录为 NONE
+  uint64_t firstEntry;
+  uint32_t entryCount;
+  int32_t error;             // 打开目录失败时的 errno
+};
+
+// 只读地映射上次的快照，可被多个线程同时使用
+class SnapshotReader {
+public:
+  static constexpr uint32_t NONE = UINT32_MAX;
+
+  SnapshotReader();
+  ~SnapshotReader();
+
+  // 映射快照文件；文件不存在或格式不对时返回 false
+  bool open(const std::string &file);
+
+  // 根目录的编号；快照的根与 path 不同时为 NONE
+  uint32_t root(const std::string &path) const;
+
+  // 目录在快照之后没有变化：身份与时间戳相同，且上次读目录时
+  // 时间戳已经稳定（之后的修改不会得到相同的时间戳）
+  bool unchanged(uint32_t directory, const DirectoryStamp &stamp) const;
+
+  // 取出目录的目录项，顺序与上次读取时相同
+  void loadEntries(uint32_t directory,
+                   std::vector<DirectoryEntry> &entries) const;
+
+  // 按名字查找子目录，cursor 记录上次找到的位置，按顺序查找时不必从头比较
+  uint32_t findChild(uint32_t directory, const char *name,
+                     size_t &cursor) const;
+
+  const SnapshotEntry *entries(uint32_t directory, uint32_t &count) const;
+  // 名字表中的字符串；表以 '\0' 结尾，越界的偏移返回空串
+  const char *name(uint32_t offset) const {
+    return offset < header->namesSize ? names + offset : "";
+  }
+  int error(uint32_t directory) const { return directories[directory].error; }
+
+private:
+  SnapshotReader(const SnapshotReader &) = delete;
+  SnapshotReader &operator=(const SnapshotReader &) = delete;
+
+  bool validate();
+
+  void *map;
+  size_t mapSize;
+  const SnapshotHeader *header;
+  const SnapshotEntry *entryRecords;
+  const SnapshotDirectory *directories;
+  const char *names;
+  std::vector<uint32_t> childStart; // 按父目录分组的子目录（CSR）
+  std::vector<uint32_t> childList;
+};
+
+// 按先序逐个目录写出新的快照，写完后替换原文件。
+// 目录项随写随出，内存中只保留目录记录与名字表
+class SnapshotWriter {
+public:
+  SnapshotWriter();
+  ~SnapshotWriter(); // 没有完成时删除临时文件
+
+  // 创建临时文件；失败时返回 errno，成功返回 0
+  int open(const std::string &file, const std::string &rootPath,
+           int64_t scanTime);
+
+  // 加入一个目录，返回它的编号；父目录必须已经加入
+  uint32_t addDirectory(uint32_t parent, const std::string &name,
+                        const DirectoryStamp &stamp, int error,
+                        const std::vector<DirectoryEntry> &entries);
+
+  // 写出目录记录与名字表并替换原文件；失败时返回 errno
+  int finish();
+
+private:
+  SnapshotWriter(const SnapshotWriter &) = delete;
+  SnapshotWriter &operator=(const SnapshotWriter &) = delete;
+
+  uint32_t intern(const std::string &name);
+  void write(const void *data, size_t length);
+  void flush();
+
+  int fd;
+  int writeError;
+  std::string file;
+  std::string temporary;
+  SnapshotHeader header;
+  uint64_t entryCount;
+  std::string buffer;                    // 待写出的目录项记录
+  std::vector<SnapshotDirectory> directories;
+  std::string names;
+  std::unordered_map<std::string, uint32_t> nameOffsets;
+};
@@ -0,0 +1,88 @@
+#include "WorkStealingPool.h"
+
+// 当前线程所属的线程池与队列编号，外部线程为空
+static thread_local WorkStealingPool *currentPool = nullptr;
+static thread_local int currentIndex = -1;
+
+WorkStealingPool::WorkStealingPool(int threadCount)
+    : queued(0), nextQueue(0), stopping(false) {
+  if (threadCount < 1)
+    threadCount = 1;
+  for (int i = 0; i < threadCount; ++i)
+    workers.emplace_back(new Worker);
+  for (int i = 0; i < threadCount; ++i)
+    threads.emplace_back(&WorkStealingPool::workerLoop, this, i);
+}
+
+WorkStealingPool::~WorkStealingPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  wakeup.notify_all();
+  for (auto &thread : threads)
+    thread.join();
+}
+
+void WorkStealingPool::submit(std::function<void()> task) {
+  int index = currentPool == this
+                  ? currentIndex
+                  : static_cast<int>(nextQueue.fetch_add(1) % workers.size());
+  {
+    std::lock_guard<std::mutex> lock(workers[index]->mutex);
+    workers[index]->tasks.push_back(std::move(task));
+  }
+  queued.fetch_add(1);
+
+  // 与空闲线程检查 queued 之后的等待配对，避免丢失唤醒
+  { std::lock_guard<std::mutex> lock(mutex); }
+  wakeup.notify_one();
+}
+
+bool WorkStealingPool::takeTask(int index, std::function<void()> &task) {
+  {
+    Worker &own = *workers[index];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if (!own.tasks.empty()) {
+      task = std::move(own.tasks.back());
+      own.tasks.pop_back();
+      queued.fetch_sub(1);
+      return true;
+    }
+  }
+
+  // 从下一个线程开始依次尝试窃取，取队首最早提交的任务
+  for (size_t i = 1; i < workers.size(); ++i) {
+    Worker &victim = *workers[(index + i) % workers.size()];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if (!victim.tasks.empty()) {
+      task = std::move(victim.tasks.front());
+      victim.tasks.pop_front();
+      queued.fetch_sub(1);
+      return true;
+    }
+  }
+  return false;
+}
+
+void WorkStealingPool::workerLoop(int index) {
+  currentPool = this;
+  currentIndex = index;
+
+  std::function<void()> task;
+  while (true) {
+    if (takeTask(index, task)) {
+      task();
+      task = nullptr;
+      continue;
+    }
+
+    // 没有任务时休眠；停止时所有任务都已执行完才退出
+    std::unique_lock<std::mutex> lock(mutex);
+    if (queued.load() == 0) {
+      if (stopping)
+        break;
+      wakeup.wait(lock);
+    }
+  }
+}
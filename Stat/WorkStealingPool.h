@@ -0,0 +1,42 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// 工作窃取线程池：每个工作线程有自己的任务队列，从队尾取自己提交的任务
+// （后进先出，接近深度优先），空闲时从其他线程的队首窃取较早提交的任务
+class WorkStealingPool {
+public:
+  explicit WorkStealingPool(int threadCount);
+  ~WorkStealingPool(); // 执行完所有任务后结束工作线程
+
+  // 提交任务：在工作线程中提交时放入自己的队列，否则轮流放入各队列
+  void submit(std::function<void()> task);
+
+private:
+  WorkStealingPool(const WorkStealingPool &) = delete;
+  WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+  // 一个工作线程的任务队列
+  struct Worker {
+    std::mutex mutex;
+    std::deque<std::function<void()>> tasks;
+  };
+
+  void workerLoop(int index);
+  bool takeTask(int index, std::function<void()> &task); // 先取自己的再窃取
+
+  std::vector<std::unique_ptr<Worker>> workers;
+  std::vector<std::thread> threads;
+  std::atomic<size_t> queued;     // 所有队列中的任务数
+  std::atomic<unsigned> nextQueue; // 外部提交时轮流选择的队列
+  std::mutex mutex;               // 配合条件变量使用，保护 stopping
+  std::condition_variable wakeup; // 有新任务或停止时唤醒空闲线程
+  bool stopping;
+};
@@ -1,20 +1,34 @@
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <climits>
 #include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
 #include <cstring>
 #include <ctime>
 #include <dirent.h>
-#include <grp.h>
-#include <iomanip>
+#include <fcntl.h>
 #include <iostream>
-#include <map>
-#include <pwd.h>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <sys/stat.h>
+#include <thread>
 #include <unistd.h>
+#include <unordered_map>
 #include <vector>
 
+#include "DirectoryScanner.h"
+#include "IdNameCache.h"
+#include "InodeSet.h"
+#include "Snapshot.h"
+#include "WorkStealingPool.h"
+
 // 文件信息结构体，封装单个文件的元数据信息
 struct FileInfo {
-  std::string path;        // 文件的完整路径
   std::string name;        // 文件名
   mode_t mode;             // 文件模式（类型和权限）
   int links;               // 硬链接数
@@ -24,197 +38,952 @@ struct FileInfo {
   time_t modificationTime; // 最后修改时间
   std::string linkTarget; // 符号链接目标路径（如果是符号链接）
 
-  // 构造函数初始化路径和文件名
-  FileInfo(const std::string &path, const std::string &name)
-      : path(path), name(name), mode(0), links(0), size(0),
-        modificationTime(0) {}
+  FileInfo() : mode(0), links(0), size(0), modificationTime(0) {}
+
+  // 换成另一个文件：字符串复用已有的空间，逐行处理时不再分配内存；
+  // 完整路径只在需要时拼接
+  void reset(const std::string &fileName) {
+    name.assign(fileName);
+    mode = 0;
+    links = 0;
+    owner.clear();
+    group.clear();
+    size = 0;
+    modificationTime = 0;
+    linkTarget.clear();
+  }
 };
 
-// 文件信息格式化工具类，提供静态方法处理权限、大小和时间
+// 文件信息格式化工具类，提供静态方法处理权限、大小和时间；
+// 结果直接追加到输出缓冲区，不产生临时字符串
 class FileFormatter {
 public:
-  // 格式化文件权限
-  static std::string formatPermissions(mode_t mode) {
-    std::string perms;
-    perms += (mode & S_IRUSR) ? 'r' : '-'; // 用户读权限
-    perms += (mode & S_IWUSR) ? 'w' : '-'; // 用户写权限
-    perms += (mode & S_IXUSR) ? 'x' : '-'; // 用户执行权限
-    perms += (mode & S_IRGRP) ? 'r' : '-'; // 组读权限
-    perms += (mode & S_IWGRP) ? 'w' : '-'; // 组写权限
-    perms += (mode & S_IXGRP) ? 'x' : '-'; // 组执行权限
-    perms += (mode & S_IROTH) ? 'r' : '-'; // 其他读权限
-    perms += (mode & S_IWOTH) ? 'w' : '-'; // 其他写权限
-    perms += (mode & S_IXOTH) ? 'x' : '-'; // 其他执行权限
-    return perms;
-  }
-
-  // 将文件大小格式化为人类可读格式（如 KB、MB 等）
-  static std::string formatSize(off_t size) {
+  // 追加文件权限，每组权限查表得到
+  static void appendPermissions(std::string &out, mode_t mode) {
+    static const char triads[8][4] = {"---", "--x", "-w-", "-wx",
+                                      "r--", "r-x", "rw-", "rwx"};
+    out.append(triads[(mode >> 6) & 7], 3); // 用户权限
+    out.append(triads[(mode >> 3) & 7], 3); // 组权限
+    out.append(triads[mode & 7], 3);        // 其他用户权限
+  }
+
+  // 将文件大小格式化为人类可读格式（如 KB、MB 等），与 "%.2f %s" 相同
+  static void appendSize(std::string &out, off_t size) {
     static const char *units[] = {"B", "KB", "MB", "GB", "TB", "PB"};
-    int unitIndex = 0;
-    double readableSize = static_cast<double>(size);
 
-    // 递归除以 1024，直到找到合适的单位
-    while (readableSize >= 1024 && unitIndex < 5) {
-      readableSize /= 1024;
+    // 整数运算只在大小可以精确转换为 double 时与浮点结果一致
+    if (size < 0 || size > (off_t(1) << 53)) {
+      appendSizeSlow(out, size);
+      return;
+    }
+
+    // 除以 1024，直到找到合适的单位
+    int unitIndex = 0;
+    unsigned shift = 0;
+    while (unitIndex < 5 && (static_cast<uint64_t>(size) >> shift) >= 1024) {
+      shift += 10;
       ++unitIndex;
     }
 
-    // 格式化为两位小数，返回字符串
-    char formattedSize[20];
-    snprintf(formattedSize, sizeof(formattedSize), "%.2f %s", readableSize,
-             units[unitIndex]);
-    return std::string(formattedSize);
+    // 保留两位小数，与 printf 一样恰好一半时舍入到偶数
+    unsigned __int128 scaled = static_cast<unsigned __int128>(size) * 100;
+    unsigned __int128 divisor = static_cast<unsigned __int128>(1) << shift;
+    uint64_t hundredths = static_cast<uint64_t>(scaled >> shift);
+    unsigned __int128 remainder = scaled & (divisor - 1);
+    if (remainder * 2 > divisor ||
+        (remainder * 2 == divisor && (hundredths & 1)))
+      ++hundredths;
+
+    appendNumber(out, hundredths / 100);
+    out += '.';
+    out += static_cast<char>('0' + hundredths / 10 % 10);
+    out += static_cast<char>('0' + hundredths % 10);
+    out += ' ';
+    out += units[unitIndex];
+  }
+
+  // 追加文件修改时间，格式：YYYY-MM-DD HH:MM
+  static void appendTime(std::string &out, time_t rawTime) {
+    // 每个线程缓存最近用到的小时：同一小时内只有分钟不同，
+    // 不必每次调用 localtime_r。时区偏移在该小时内变化时不缓存
+    struct HourEntry {
+      time_t start = -1;   // 该小时的起点（UTC 整点）
+      bool cacheable = false;
+      int secondsIntoLocalHour = 0; // 起点在本地时间的小时内已过的秒数
+      char prefix[32];     // "YYYY-MM-DD HH:"
+      size_t length = 0;
+    };
+    thread_local HourEntry hours[64];
+
+    time_t start = rawTime - ((rawTime % 3600) + 3600) % 3600;
+    HourEntry &entry = hours[static_cast<uint64_t>(start / 3600) % 64];
+    if (entry.start != start) {
+      entry.start = start;
+      struct tm first, last;
+      time_t end = start + 3599;
+      localtime_r(&start, &first); // 可在多个线程中同时调用
+      localtime_r(&end, &last);
+      entry.cacheable = first.tm_gmtoff == last.tm_gmtoff;
+      entry.secondsIntoLocalHour = first.tm_min * 60 + first.tm_sec;
+      entry.length = strftime(entry.prefix, sizeof(entry.prefix),
+                              "%Y-%m-%d %H:", &first);
+    }
+
+    int seconds = entry.secondsIntoLocalHour + static_cast<int>(rawTime - start);
+    if (!entry.cacheable || seconds >= 3600) {
+      // 时区偏移不是整小时或在该小时内变化：直接格式化
+      char timeBuffer[20];
+      struct tm timeInfo;
+      localtime_r(&rawTime, &timeInfo);
+      out.append(timeBuffer, strftime(timeBuffer, sizeof(timeBuffer),
+                                       "%Y-%m-%d %H:%M", &timeInfo));
+      return;
+    }
+    int minute = seconds / 60;
+    out.append(entry.prefix, entry.length);
+    out += static_cast<char>('0' + minute / 10);
+    out += static_cast<char>('0' + minute % 10);
+  }
+
+  // 十进制整数写入 text（至少 20 字节），返回长度
+  static size_t formatNumber(char *text, uint64_t value) {
+    char digits[20];
+    size_t length = 0;
+    do {
+      digits[length++] = static_cast<char>('0' + value % 10);
+      value /= 10;
+    } while (value != 0);
+    for (size_t i = 0; i < length; ++i)
+      text[i] = digits[length - 1 - i];
+    return length;
   }
 
-  // 格式化文件修改时间
-  static std::string formatTime(time_t rawTime) {
-    char timeBuffer[20];
-    struct tm *timeInfo = localtime(&rawTime);
-    strftime(timeBuffer, sizeof(timeBuffer), "%Y-%m-%d %H:%M",
-             timeInfo); // 格式：YYYY-MM-DD HH:MM
-    return std::string(timeBuffer);
+  // 追加十进制整数
+  static void appendNumber(std::string &out, uint64_t value) {
+    char text[20];
+    out.append(text, formatNumber(text, value));
+  }
+
+  // 右对齐到 width 宽度，与 std::setw 相同，超出时不截断
+  static void appendPadded(std::string &out, const char *text, size_t length,
+                           size_t width) {
+    if (length < width)
+      out.append(width - length, ' ');
+    out.append(text, length);
+  }
+
+  // 用户名，查不到时为用户编号；结果由 IdNameCache 缓存
+  static const std::string &formatOwner(uid_t uid) {
+    return IdNameCache::userName(uid);
+  }
+
+  // 组名，查不到时为组编号
+  static const std::string &formatGroup(gid_t gid) {
+    return IdNameCache::groupName(gid);
+  }
+
+private:
+  static void appendSizeSlow(std::string &out, off_t size) {
+    static const char *units[] = {"B", "KB", "MB", "GB", "TB", "PB"};
+    int unitIndex = 0;
+    double readableSize = static_cast<double>(size);
+    while (readableSize >= 1024 && unitIndex < 5) {
+      readableSize /= 1024;
+      ++unitIndex;
+    }
+    char formattedSize[40];
+    int length = snprintf(formattedSize, sizeof(formattedSize), "%.2f %s",
+                          readableSize, units[unitIndex]);
+    out.append(formattedSize, length);
   }
 };
 
 // 文件类型颜色策略类，根据文件类型返回对应的颜色代码
 class FileColorizer {
 private:
-  // 文件类型与颜色代码的映射
-  std::map<mode_t, std::string> typeColors = {
-      {S_IFDIR, "34"}, // 目录: 蓝色
-      {S_IFLNK, "36"}, // 符号链接: 青色
-      {S_IFCHR, "32"}, // 字符设备: 绿色
-      {S_IFBLK, "33"}, // 块设备: 黄色
-      {S_IFIFO, "35"}, // 管道: 紫色
-      {S_IFSOCK, "31"} // 套接字: 红色
-  };
+  // 按文件类型（S_IFMT 的高 4 位）索引的颜色转义序列
+  const char *typeColors[16];
 
 public:
-  // 根据文件类型为文本着色
-  std::string colorize(const std::string &text, mode_t mode) {
-    std::string colorCode = "0"; // 默认颜色
-    for (const auto &[fileType, color] : typeColors) {
-      if ((mode & S_IFMT) == fileType) { // 比较文件类型
-        colorCode = color;
-        break;
+  FileColorizer() {
+    for (const char *&color : typeColors)
+      color = "\033[0m"; // 默认颜色
+    typeColors[S_IFDIR >> 12] = "\033[34m";  // 目录: 蓝色
+    typeColors[S_IFLNK >> 12] = "\033[36m";  // 符号链接: 青色
+    typeColors[S_IFCHR >> 12] = "\033[32m";  // 字符设备: 绿色
+    typeColors[S_IFBLK >> 12] = "\033[33m";  // 块设备: 黄色
+    typeColors[S_IFIFO >> 12] = "\033[35m";  // 管道: 紫色
+    typeColors[S_IFSOCK >> 12] = "\033[31m"; // 套接字: 红色
+  }
+
+  // 颜色开始的转义序列
+  const char *begin(mode_t mode) const {
+    return typeColors[(mode & S_IFMT) >> 12];
+  }
+
+  // 恢复默认颜色的转义序列
+  static const char *end() { return "\033[0m"; }
+};
+
+// 标准输出的缓冲区：积累到一定大小后一次写出，
+// 不经过 iostream 的逐次格式化与刷新
+class OutputBuffer {
+public:
+  explicit OutputBuffer(int fd) : fd(fd) { buffer.reserve(CAPACITY); }
+  ~OutputBuffer() { flush(); }
+
+  void append(const std::string &text) { append(text.data(), text.size()); }
+
+  void append(const char *data, size_t length) {
+    if (buffer.size() + length > CAPACITY)
+      flush();
+    if (length >= CAPACITY)
+      writeAll(data, length); // 大块内容不经缓冲区直接写出
+    else
+      buffer.append(data, length);
+  }
+
+  void flush() {
+    writeAll(buffer.data(), buffer.size());
+    buffer.clear();
+  }
+
+private:
+  static const size_t CAPACITY = 1 << 20;
+
+  void writeAll(const char *data, size_t length) {
+    while (length > 0) {
+      ssize_t n = write(fd, data, length);
+      if (n == -1) {
+        if (errno == EINTR)
+          continue;
+        return; // 与 std::cout 一样，写失败时丢弃输出
       }
+      data += n;
+      length -= n;
     }
-    return "\033[" + colorCode + "m" + text + "\033[0m"; // 添加颜色转义序列
   }
+
+  int fd;
+  std::string buffer;
+};
+
+// 一个目录的遍历结果：该目录自身的输出与按顺序排列的子目录。
+// 并行遍历时各目录的输出先缓存在这里，再按递归遍历的顺序输出
+struct DirectoryNode {
+  std::string path;   // 目录路径
+  int fd;             // 已相对于父目录打开的描述符，未打开时为 -1
+  DirectoryNode *parent; // 父目录，根目录为空
+  int depth;          // 根目录为 0
+  std::string output; // 标准输出的内容
+  std::string errors; // 标准错误的内容
+  // 每条错误信息之后 output 与 errors 的长度，输出时按此交错两者
+  std::vector<std::pair<size_t, size_t>> errorMarks;
+  // 子目录；并行遍历时尚未执行的任务也持有引用，输出后才能释放
+  std::vector<std::shared_ptr<DirectoryNode>> children;
+  bool done;          // 遍历是否完成
+  std::atomic<bool> claimed{false}; // 已由某个线程开始遍历
+  size_t buffered = 0; // 遍历后到输出前占用的字节数
+
+  // 磁盘用量模式：整棵子树的合计，子目录完成时加到父目录上
+  std::atomic<uint64_t> size{0};   // 文件大小之和
+  std::atomic<uint64_t> blocks{0}; // 占用的 512 字节块数之和
+  std::atomic<uint64_t> files{0};  // 目录以外的文件数
+  std::atomic<size_t> pending{0};  // 尚未合计完成的子目录数，加上自身
+  bool totalled;                   // 整棵子树是否已合计完成
+
+  // 快照：上次快照中对应的目录、本次取得的时间戳与写出时需要的内容
+  uint32_t previous = SnapshotReader::NONE;
+  DirectoryStamp stamp;
+  int error = 0;                       // 打开目录失败时的 errno
+  std::vector<DirectoryEntry> entries; // 写快照时保留到输出为止
+  uint32_t recorded = SnapshotReader::NONE; // 在新快照中的编号
+
+  explicit DirectoryNode(const std::string &path, int fd = -1,
+                         DirectoryNode *parent = nullptr)
+      : path(path), fd(fd), parent(parent),
+        depth(parent ? parent->depth + 1 : 0), done(false), totalled(false) {}
 };
 
 // 目录打印器类，负责递归遍历目录并打印文件信息
 class DirectoryPrinter {
 private:
   FileColorizer colorizer; // 用于文件名着色
+  OutputBuffer out{STDOUT_FILENO}; // 标准输出
+
+  std::mutex mutex;                  // 保护各节点的 done 与 buffered
+  std::condition_variable completed; // 有目录遍历完成时通知输出线程
+  std::condition_variable drained;   // 输出线程释放了缓冲的内容
+
+  // 并行遍历时已遍历但尚未输出的目录占用的字节数，超过上限时
+  // 工作线程等待输出线程赶上，避免输出较慢时整棵树都堆积在内存中
+  static const size_t MAX_BUFFERED = 64 << 20;
+  size_t buffered = 0;
+
+  // 可以预先打开的子目录描述符数，用完后子目录按路径打开
+  std::atomic<int> openBudget{256};
+
+  bool usageMode = false;  // 只统计磁盘用量，不列出文件
+  int maxDepth = INT_MAX;  // 磁盘用量模式下输出的最大目录深度
+  InodeSet hardLinks;      // 已统计过的多链接文件
+
+  std::unique_ptr<SnapshotReader> snapshot; // 上次的快照，没有时为空
+  std::unique_ptr<SnapshotWriter> recorder; // 本次写出的快照
+  bool diffMode = false; // 只输出与上次快照的差异
+
+  // 与 perror 相同格式的错误信息
+  static std::string errorMessage(const char *what, int error) {
+    return std::string(what) + ": " + strerror(error) + "\n";
+  }
 
-  // 从文件系统获取文件信息，填充 FileInfo 结构体
-  void fetchFileInfo(const std::string &path, const std::string &filename,
-                     FileInfo &fileInfo) {
-    std::string fullPath = path + "/" + filename;
-    struct stat fileStat;
+  // 记录一条错误信息及其在标准输出中的位置
+  static void addError(DirectoryNode &node, const std::string &message) {
+    node.errors += message;
+    node.errorMarks.emplace_back(node.output.size(), node.errors.size());
+  }
 
-    // 使用 lstat 获取文件信息（符号链接保留自身信息）
-    if (lstat(fullPath.c_str(), &fileStat) == -1) {
-      perror("lstat");
+  // 用目录项的元数据填充 FileInfo 结构体
+  void fetchFileInfo(const DirectoryEntry &entry, FileInfo &fileInfo,
+                     DirectoryNode &node) {
+    // 元数据按 lstat 的语义取得（符号链接保留自身信息）
+    if (entry.error != 0) {
+      addError(node, errorMessage("lstat", entry.error));
       return;
     }
 
-    fileInfo.mode = fileStat.st_mode;
-    fileInfo.links = fileStat.st_nlink;
-
-    // 获取所有者名称
-    struct passwd *pwd = getpwuid(fileStat.st_uid);
-    fileInfo.owner = pwd ? pwd->pw_name : std::to_string(fileStat.st_uid);
+    fileInfo.mode = entry.mode;
+    fileInfo.links = entry.links;
 
-    // 获取所属组名称
-    struct group *grp = getgrgid(fileStat.st_gid);
-    fileInfo.group = grp ? grp->gr_name : std::to_string(fileStat.st_gid);
+    // 获取所有者与所属组名称
+    fileInfo.owner.assign(FileFormatter::formatOwner(entry.uid));
+    fileInfo.group.assign(FileFormatter::formatGroup(entry.gid));
 
-    fileInfo.size = fileStat.st_size;              // 文件大小
-    fileInfo.modificationTime = fileStat.st_mtime; // 修改时间
+    fileInfo.size = entry.size;                         // 文件大小
+    fileInfo.modificationTime = entry.modificationTime; // 修改时间
 
     // 如果是符号链接，获取其目标路径
-    if (S_ISLNK(fileStat.st_mode)) {
-      char linkTarget[1024];
-      ssize_t len =
-          readlink(fullPath.c_str(), linkTarget, sizeof(linkTarget) - 1);
-      if (len != -1) {
-        linkTarget[len] = '\0';
-        fileInfo.linkTarget = linkTarget;
-      }
+    if (S_ISLNK(entry.mode)) {
+      fileInfo.linkTarget.assign(entry.linkTarget);
     }
   }
 
-  // 打印单个文件的信息
-  void printFileInfo(const FileInfo &fileInfo) {
-    std::string fileType(
-        1, FileFormatter::formatPermissions(fileInfo.mode)[0]); // 文件类型
-    std::string permissions =
-        FileFormatter::formatPermissions(fileInfo.mode); // 权限字符串
-    std::string size = FileFormatter::formatSize(fileInfo.size); // 格式化大小
-    std::string modificationTime =
-        FileFormatter::formatTime(fileInfo.modificationTime); // 格式化时间
+  // 格式化单个文件的信息，追加到 output
+  void printFileInfo(const FileInfo &fileInfo, std::string &output) const {
+    // 文件类型列沿用权限字符串的首字符
+    output += (fileInfo.mode & S_IRUSR) ? 'r' : '-';
+    FileFormatter::appendPermissions(output, fileInfo.mode); // 权限字符串
+    output += ' ';
+
+    char links[24];
+    size_t length =
+        fileInfo.links >= 0
+            ? FileFormatter::formatNumber(links, fileInfo.links)
+            : snprintf(links, sizeof(links), "%d", fileInfo.links);
+    FileFormatter::appendPadded(output, links, length, 3);
+    output += ' ';
+    FileFormatter::appendPadded(output, fileInfo.owner.data(),
+                                fileInfo.owner.size(), 8);
+    output += ' ';
+    FileFormatter::appendPadded(output, fileInfo.group.data(),
+                                fileInfo.group.size(), 8);
+    output += ' ';
+
+    // 大小右对齐到 10 个字符：先追加，再在前面补空格
+    size_t sizeStart = output.size();
+    FileFormatter::appendSize(output, fileInfo.size); // 格式化大小
+    size_t sizeLength = output.size() - sizeStart;
+    if (sizeLength < 10)
+      output.insert(sizeStart, 10 - sizeLength, ' ');
+    output += ' ';
+
+    FileFormatter::appendTime(output, fileInfo.modificationTime); // 格式化时间
+    output += ' ';
 
-    std::string name = fileInfo.name; // 文件名
+    // 文件名着色，符号链接附带目标
+    output += colorizer.begin(fileInfo.mode);
+    output += fileInfo.name;
     if (!fileInfo.linkTarget.empty()) {
-      name += " -> " + fileInfo.linkTarget; // 符号链接目标
+      output += " -> ";
+      output += fileInfo.linkTarget;
+    }
+    output += FileColorizer::end();
+    output += '\n';
+  }
+
+  // 遍历一个目录，输出与子目录记录在节点中，不递归
+  void scanDirectory(DirectoryNode &node) {
+    const std::string &path = node.path;
+    int dirfd = node.fd;
+    if (dirfd >= 0) {
+      node.fd = -1;
+      openBudget.fetch_add(1);
+    } else {
+      dirfd = open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    }
+    if (dirfd == -1) {
+      node.error = errno;
+      addError(node, errorMessage("opendir", errno));
+      return;
     }
 
-    // 文件名着色
-    name = colorizer.colorize(name, fileInfo.mode);
+    if (!usageMode && !diffMode)
+      node.output += "\n" + path + ":\n";
 
-    // 输出文件信息
-    std::cout << fileType << permissions << " " << std::setw(3)
-              << fileInfo.links << " " << std::setw(8) << fileInfo.owner << " "
-              << std::setw(8) << fileInfo.group << " " << std::setw(10) << size
-              << " " << modificationTime << " " << name << std::endl;
+    std::vector<DirectoryEntry> entries;
+    bool reused = snapshot && node.previous != SnapshotReader::NONE &&
+                  snapshot->error(node.previous) == 0 &&
+                  snapshot->unchanged(node.previous, node.stamp);
+    if (reused) {
+      // 目录没有变化：目录项取自快照，只有子目录需要重新取得元数据
+      snapshot->loadEntries(node.previous, entries);
+      refreshSubdirectories(dirfd, entries);
+      if (diffMode)
+        diffSubdirectories(node, entries);
+    } else {
+      // 读出全部目录项后成批取得元数据；与 readdir 一样，读目录出错时
+      // 只列出已读到的部分
+      DirectoryScanner::readEntries(dirfd, entries);
+      DirectoryScanner::statEntries(dirfd, entries);
+      if (!usageMode) {
+        for (DirectoryEntry &entry : entries)
+          if (entry.error == 0 && S_ISLNK(entry.mode))
+            DirectoryScanner::readLink(dirfd, entry.name, entry.linkTarget);
+      }
+      if (diffMode)
+        diffEntries(node, entries);
+    }
+
+    // 遍历当前目录下的每个文件和子目录；同一个 FileInfo 逐行复用
+    FileInfo fileInfo;
+    size_t cursor = 0; // 在快照中按顺序查找子目录
+    for (const DirectoryEntry &entry : entries) {
+      if (usageMode) {
+        countUsage(node, entry);
+      } else if (diffMode) {
+        if (entry.error != 0)
+          addError(node, errorMessage("lstat", entry.error));
+      } else {
+        fileInfo.reset(entry.name); // 初始化文件信息结构
+        fetchFileInfo(entry, fileInfo, node);
+        printFileInfo(fileInfo, node.output);
+      }
+
+      // 如果是子目录，加入待处理列表；相对于当前目录打开，
+      // 之后遍历时不再从根解析路径
+      if (S_ISDIR(entry.mode) && entry.type == DT_DIR) {
+        int fd = -1;
+        if (openBudget.fetch_sub(1) > 0)
+          fd = openat(dirfd, entry.name.c_str(),
+                      O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+        if (fd == -1)
+          openBudget.fetch_add(1);
+        DirectoryNode *child =
+            new DirectoryNode(path + "/" + entry.name, fd, &node);
+        child->size.store(entry.size); // 子目录自身计入子目录的合计
+        child->blocks.store(entry.blocks);
+        child->stamp = DirectoryStamp::fromEntry(entry);
+        if (snapshot && node.previous != SnapshotReader::NONE)
+          child->previous =
+              snapshot->findChild(node.previous, entry.name.c_str(), cursor);
+        node.children.emplace_back(child);
+      }
+    }
+
+    close(dirfd);
+    if (recorder)
+      node.entries = std::move(entries);
   }
 
-public:
-  // 遍历目录并递归处理子目录
-  void listDirectory(const std::string &path) {
-    DIR *dir = opendir(path.c_str());
-    if (!dir) {
-      perror("opendir");
+  // 重新取得子目录的元数据：子目录的时间戳决定是否重新读取它，
+  // 列表中子目录一行的内容也随之更新
+  static void refreshSubdirectories(int dirfd,
+                                    std::vector<DirectoryEntry> &entries) {
+    std::vector<DirectoryEntry> subdirectories;
+    std::vector<size_t> positions;
+    for (size_t i = 0; i < entries.size(); ++i) {
+      const DirectoryEntry &entry = entries[i];
+      if (entry.error == 0 && S_ISDIR(entry.mode) && entry.type == DT_DIR) {
+        subdirectories.push_back(entry);
+        subdirectories.back().error = 0;
+        positions.push_back(i);
+      }
+    }
+    DirectoryScanner::statEntries(dirfd, subdirectories);
+    for (size_t i = 0; i < positions.size(); ++i)
+      entries[positions[i]] = std::move(subdirectories[i]);
+  }
+
+  // 差异输出的一行：A 新增，D 删除，M 修改
+  static void appendChange(std::string &output, char change,
+                           const std::string &path, const char *name) {
+    output += change;
+    output += '\t';
+    output += path;
+    output += '/';
+    output += name;
+    output += '\n';
+  }
+
+  // 文件是否变化；目录的大小与时间随其中的内容变化，只比较类型与权限
+  static bool modified(const SnapshotEntry &old, const DirectoryEntry &entry,
+                       const char *oldTarget) {
+    if (old.error != entry.error)
+      return true;
+    if (entry.error != 0)
+      return false;
+    if (old.mode != entry.mode || old.uid != entry.uid || old.gid != entry.gid)
+      return true;
+    if (S_ISDIR(entry.mode))
+      return false;
+    return old.size != entry.size ||
+           old.modificationTime != entry.modificationTime ||
+           old.modificationNsec != entry.modificationNsec ||
+           old.links != entry.links || entry.linkTarget != oldTarget;
+  }
+
+  // 重新读取的目录与快照比较，差异按目录项的顺序追加到输出，
+  // 删除的目录项在最后，删除的子目录连同其中的内容一起列出
+  void diffEntries(DirectoryNode &node,
+                   const std::vector<DirectoryEntry> &entries) {
+    uint32_t count = 0;
+    const SnapshotEntry *oldEntries = nullptr;
+    if (snapshot && node.previous != SnapshotReader::NONE)
+      oldEntries = snapshot->entries(node.previous, count);
+
+    std::unordered_map<std::string, uint32_t> oldIndex;
+    for (uint32_t i = 0; i < count; ++i)
+      oldIndex.emplace(snapshot->name(oldEntries[i].name), i);
+    std::vector<bool> seen(count, false);
+
+    for (const DirectoryEntry &entry : entries) {
+      auto it = oldIndex.find(entry.name);
+      if (it == oldIndex.end()) {
+        appendChange(node.output, 'A', node.path, entry.name.c_str());
+        continue;
+      }
+      const SnapshotEntry &old = oldEntries[it->second];
+      seen[it->second] = true;
+      const char *oldTarget =
+          old.linkTarget != SnapshotReader::NONE ? snapshot->name(old.linkTarget)
+                                                 : "";
+      if (modified(old, entry, oldTarget))
+        appendChange(node.output, 'M', node.path, entry.name.c_str());
+
+      // 子目录换成了其他文件：原来子目录中的内容都已删除
+      bool subdirectory =
+          entry.error == 0 && S_ISDIR(entry.mode) && entry.type == DT_DIR;
+      if (old.isSubdirectory() && !subdirectory)
+        appendRemovedContents(node.output, node.previous,
+                              node.path + "/" + entry.name,
+                              snapshot->name(old.name));
+    }
+
+    for (uint32_t i = 0; i < count; ++i) {
+      if (seen[i])
+        continue;
+      const char *name = snapshot->name(oldEntries[i].name);
+      appendChange(node.output, 'D', node.path, name);
+      if (oldEntries[i].isSubdirectory())
+        appendRemovedContents(node.output, node.previous,
+                              node.path + "/" + name, name);
+    }
+  }
+
+  // 复用快照的目录中只有子目录重新取得了元数据，与快照中的记录比较；
+  // entries 由 loadEntries 取得，与快照中的目录项一一对应
+  void diffSubdirectories(DirectoryNode &node,
+                          const std::vector<DirectoryEntry> &entries) {
+    uint32_t count;
+    const SnapshotEntry *oldEntries = snapshot->entries(node.previous, count);
+    for (uint32_t i = 0; i < count && i < entries.size(); ++i) {
+      const SnapshotEntry &old = oldEntries[i];
+      if (!old.isSubdirectory())
+        continue;
+      const DirectoryEntry &entry = entries[i];
+      if (modified(old, entry, ""))
+        appendChange(node.output, 'M', node.path, entry.name.c_str());
+      if (entry.error != 0 || !S_ISDIR(entry.mode))
+        appendRemovedContents(node.output, node.previous,
+                              node.path + "/" + entry.name,
+                              snapshot->name(old.name));
+    }
+  }
+
+  // 列出快照中一个已删除子目录里的全部内容
+  void appendRemovedContents(std::string &output, uint32_t parent,
+                             const std::string &path, const char *name) {
+    size_t cursor = 0;
+    uint32_t directory = snapshot->findChild(parent, name, cursor);
+    if (directory == SnapshotReader::NONE)
+      return;
+    uint32_t count;
+    const SnapshotEntry *entries = snapshot->entries(directory, count);
+    for (uint32_t i = 0; i < count; ++i) {
+      const char *entryName = snapshot->name(entries[i].name);
+      appendChange(output, 'D', path, entryName);
+      if (entries[i].isSubdirectory())
+        appendRemovedContents(output, directory, path + "/" + entryName,
+                              entryName);
+    }
+  }
+
+  // 把一个目录项计入所在目录的合计；子目录自身在子目录中计入，
+  // 有多个链接的文件只计入第一次遇到的目录
+  void countUsage(DirectoryNode &node, const DirectoryEntry &entry) {
+    if (entry.error != 0) {
+      node.errors += errorMessage("lstat", entry.error);
+      return;
+    }
+    bool directory = S_ISDIR(entry.mode);
+    if (directory && entry.type == DT_DIR)
+      return;
+    if (!directory && entry.links > 1 &&
+        !hardLinks.insert(entry.dev, entry.ino))
       return;
+    node.size.fetch_add(entry.size, std::memory_order_relaxed);
+    node.blocks.fetch_add(entry.blocks, std::memory_order_relaxed);
+    if (!directory)
+      node.files.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  // 输出一个节点自身的内容；每条错误信息写出前先写出在它之前产生的
+  // 标准输出，两者交错的顺序与逐个处理目录项时相同
+  void emit(DirectoryNode &node) {
+    size_t written = 0, errorsWritten = 0;
+    for (const auto &mark : node.errorMarks) {
+      out.append(node.output.data() + written, mark.first - written);
+      writeErrors(node.errors.substr(errorsWritten,
+                                     mark.second - errorsWritten));
+      written = mark.first;
+      errorsWritten = mark.second;
+    }
+    writeErrors(node.errors.substr(errorsWritten));
+    out.append(node.output.data() + written, node.output.size() - written);
+    if (recorder)
+      record(node);
+  }
+
+  // 把目录加入新的快照；按先序输出，父目录已经加入
+  void record(DirectoryNode &node) {
+    uint32_t parent = SnapshotReader::NONE;
+    std::string name = node.path;
+    if (node.parent != nullptr) {
+      parent = node.parent->recorded;
+      name = node.path.substr(node.parent->path.size() + 1);
+    }
+    node.recorded =
+        recorder->addDirectory(parent, name, node.stamp, node.error,
+                               node.entries);
+    std::vector<DirectoryEntry>().swap(node.entries);
+  }
+
+  // 线程池中的遍历任务：缓冲的内容超过上限时先等待输出线程赶上；
+  // 等待期间输出线程可能已经自己遍历了这个节点
+  void scanParallel(WorkStealingPool &pool, DirectoryNode &node) {
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      drained.wait(lock, [this, &node]() {
+        return buffered < MAX_BUFFERED || node.claimed.load();
+      });
     }
+    if (!node.claimed.exchange(true))
+      scanClaimed(pool, node);
+  }
 
-    struct dirent *entry;
-    std::vector<std::string> subdirs; // 存储子目录以便递归
+  // 遍历节点并提交其子目录，完成后通知输出线程；
+  // 子目录倒序提交，本线程先取到第一个子目录
+  void scanClaimed(WorkStealingPool &pool, DirectoryNode &node) {
+    scanDirectory(node);
+    for (auto it = node.children.rbegin(); it != node.children.rend(); ++it) {
+      std::shared_ptr<DirectoryNode> child = *it;
+      pool.submit([this, &pool, child]() { scanParallel(pool, *child); });
+    }
+    node.buffered = node.output.capacity() + node.errors.capacity() +
+                    node.entries.capacity() * sizeof(DirectoryEntry) +
+                    node.children.size() * sizeof(DirectoryNode);
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      buffered += node.buffered;
+      node.done = true;
+    }
+    completed.notify_all();
+  }
+
+  // 按递归遍历的顺序等待并输出各节点，输出后释放。下一个要输出的节点
+  // 还没有线程开始遍历时由输出线程自己遍历，工作线程都在等待时也能继续
+  void emitInOrder(WorkStealingPool &pool, DirectoryNode &node) {
+    if (!node.claimed.exchange(true)) {
+      scanClaimed(pool, node);
+    } else {
+      std::unique_lock<std::mutex> lock(mutex);
+      completed.wait(lock, [&node]() { return node.done; });
+    }
+    emit(node);
+    std::string().swap(node.output);
+    std::string().swap(node.errors);
+    std::vector<std::pair<size_t, size_t>>().swap(node.errorMarks);
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      buffered -= node.buffered;
+    }
+    drained.notify_all();
+
+    for (auto &child : node.children) {
+      emitInOrder(pool, *child);
+      child.reset();
+    }
+  }
 
-    std::cout << "\n" << path << ":" << std::endl;
+  // 磁盘用量模式：遍历节点后提交子目录，由最后完成的子目录合计本目录
+  void scanUsage(WorkStealingPool &pool, DirectoryNode &node) {
+    scanDirectory(node);
+    node.pending.store(node.children.size() + 1);
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      node.done = true;
+    }
+    completed.notify_all();
+    for (auto it = node.children.rbegin(); it != node.children.rend(); ++it) {
+      DirectoryNode *child = it->get();
+      pool.submit([this, &pool, child]() { scanUsage(pool, *child); });
+    }
+    finishUsage(&node);
+  }
 
-    // 遍历当前目录下的每个文件和子目录
-    while ((entry = readdir(dir)) != nullptr) {
-      if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
-        continue; // 跳过 . 和 ..
+  // 一个子树完成（自身遍历或一个子目录合计完毕）。计数归零的目录把
+  // 合计加到父目录上并继续向上，不需要再遍历一次
+  void finishUsage(DirectoryNode *node) {
+    while (node != nullptr &&
+           node->pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      // 超过输出深度的子目录不再单独输出：错误信息并入本目录后释放
+      if (node->depth >= maxDepth) {
+        for (auto &child : node->children)
+          node->errors += child->errors;
+        node->children.clear();
       }
 
-      FileInfo fileInfo(path, entry->d_name); // 初始化文件信息结构
-      fetchFileInfo(path, entry->d_name, fileInfo);
-      printFileInfo(fileInfo);
+      // 先加到父目录上，标记完成后本节点可能立即被输出线程释放
+      DirectoryNode *parent = node->parent;
+      if (parent != nullptr) {
+        parent->size.fetch_add(node->size.load(std::memory_order_relaxed),
+                               std::memory_order_relaxed);
+        parent->blocks.fetch_add(node->blocks.load(std::memory_order_relaxed),
+                                 std::memory_order_relaxed);
+        parent->files.fetch_add(node->files.load(std::memory_order_relaxed),
+                                std::memory_order_relaxed);
+      }
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        node->totalled = true;
+      }
+      completed.notify_all();
+      node = parent;
+    }
+  }
 
-      // 如果是子目录，加入待处理列表
-      if (S_ISDIR(fileInfo.mode) && entry->d_type == DT_DIR) {
-        subdirs.emplace_back(fileInfo.path + "/" + fileInfo.name);
+  // 按后序（子目录在前）等待并输出各目录的合计，输出后释放
+  void emitUsage(DirectoryNode &node, std::string &line) {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (node.depth < maxDepth) {
+      completed.wait(lock, [&node]() { return node.done; });
+      lock.unlock();
+      writeErrors(node.errors);
+      for (auto &child : node.children) {
+        emitUsage(*child, line);
+        child.reset();
       }
+      lock.lock();
+    }
+    completed.wait(lock, [&node]() { return node.totalled; });
+    lock.unlock();
+    if (node.depth >= maxDepth)
+      writeErrors(node.errors);
+
+    // 大小、占用空间、文件数与路径
+    line.clear();
+    FileFormatter::appendSize(line, node.size.load());
+    line.insert(0, padding(line.size(), 10), ' ');
+    line += ' ';
+    size_t start = line.size();
+    FileFormatter::appendSize(line, node.blocks.load() * 512);
+    line.insert(start, padding(line.size() - start, 10), ' ');
+    line += ' ';
+    char files[20];
+    FileFormatter::appendPadded(
+        line, files, FileFormatter::formatNumber(files, node.files.load()), 8);
+    line += ' ';
+    line += node.path;
+    line += '\n';
+    out.append(line);
+  }
+
+  static size_t padding(size_t length, size_t width) {
+    return length < width ? width - length : 0;
+  }
+
+  // 写出标准错误的内容，先写出之前的标准输出
+  void writeErrors(const std::string &errors) {
+    if (!errors.empty()) {
+      out.flush();
+      std::cerr << errors;
     }
+  }
 
-    closedir(dir);
+  // 遍历节点并递归处理子目录
+  void listNode(DirectoryNode &node) {
+    scanDirectory(node);
+    emit(node);
 
     // 递归进入子目录
-    for (const auto &subdir : subdirs) {
-      listDirectory(subdir);
+    for (auto &subdir : node.children) {
+      listNode(*subdir);
+      subdir.reset();
+    }
+  }
+
+  // 根目录在快照中的位置与时间戳
+  void prepareRoot(DirectoryNode &root) {
+    struct stat rootStat;
+    if (!snapshot || stat(root.path.c_str(), &rootStat) == -1)
+      return;
+    root.stamp = DirectoryStamp::fromStat(rootStat);
+    root.previous = snapshot->root(root.path);
+  }
+
+public:
+  // 使用快照文件：上次的快照存在时，没有变化的目录不再读取；
+  // 遍历的同时写出新的快照。diff 为 true 时只输出与上次的差异
+  bool useSnapshot(const std::string &file, const std::string &path,
+                   bool diff) {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    snapshot.reset(new SnapshotReader);
+    if (!snapshot->open(file))
+      snapshot.reset(); // 没有可用的快照时完整遍历
+    recorder.reset(new SnapshotWriter);
+    int error = recorder->open(
+        file, path, int64_t(now.tv_sec) * 1000000000 + now.tv_nsec);
+    if (error != 0) {
+      std::cerr << "snapshot: " << strerror(error) << std::endl;
+      return false;
+    }
+    diffMode = diff;
+    return true;
+  }
+
+  // 写出新的快照并替换原文件
+  bool saveSnapshot() {
+    if (!recorder)
+      return true;
+    int error = recorder->finish();
+    if (error != 0) {
+      std::cerr << "snapshot: " << strerror(error) << std::endl;
+      return false;
+    }
+    return true;
+  }
+
+  // 遍历目录并递归处理子目录
+  void listDirectory(const std::string &path) {
+    DirectoryNode root(path);
+    prepareRoot(root);
+    listNode(root);
+  }
+
+  // 用 threads 个线程并行遍历，输出与 listDirectory 完全相同
+  void listDirectoryParallel(const std::string &path, int threads) {
+    DirectoryNode root(path);
+    prepareRoot(root);
+    WorkStealingPool pool(threads);
+    pool.submit([this, &pool, &root]() { scanParallel(pool, root); });
+    emitInOrder(pool, root);
+  }
+
+  // 磁盘用量模式：统计每个目录整棵子树的大小、占用空间与文件数，
+  // 按 du 的顺序（子目录在前）输出深度不超过 depth 的目录
+  void listUsage(const std::string &path, int threads, int depth) {
+    usageMode = true;
+    maxDepth = depth;
+
+    // 根目录自身的大小；根是文件时也计入该文件
+    DirectoryNode root(path);
+    struct stat rootStat;
+    if (stat(path.c_str(), &rootStat) == 0) {
+      root.size.store(rootStat.st_size);
+      root.blocks.store(rootStat.st_blocks);
+      if (!S_ISDIR(rootStat.st_mode))
+        root.files.store(1);
     }
+
+    WorkStealingPool pool(threads);
+    pool.submit([this, &pool, &root]() { scanUsage(pool, root); });
+    std::string line;
+    emitUsage(root, line);
   }
 };
 
+static void usage(const char *prog) {
+  std::cerr << "用法: " << prog
+            << " [-j 线程数] [--no-uring] [--prefetch-ids]"
+               " [--snapshot 文件 [--diff]] [目录]"
+            << std::endl;
+  std::cerr << "      " << prog
+            << " --du [-d 深度] [-j 线程数] [--no-uring] [目录]" << std::endl;
+}
+
 // 主函数：从指定路径开始打印目录结构
 int main(int argc, char *argv[]) {
-  const std::string path = (argc > 1) ? argv[1] : ".";
+  std::string path = ".";
+  // 遍历主要等待 lstat 等阻塞调用，线程数不少于 4 个
+  int threads = std::max(4u, std::thread::hardware_concurrency());
+  bool diskUsage = false;
+  int depth = INT_MAX;
+  std::string snapshotFile; // 为空时不使用快照
+  bool diff = false;
+
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "-j" && i + 1 < argc) {
+      threads = atoi(argv[++i]);
+    } else if (arg.compare(0, 2, "-j") == 0 && arg.size() > 2) {
+      threads = atoi(arg.c_str() + 2);
+    } else if (arg == "--du") {
+      diskUsage = true;
+    } else if (arg == "-d" && i + 1 < argc) {
+      depth = atoi(argv[++i]);
+    } else if (arg.compare(0, 2, "-d") == 0 && arg.size() > 2 &&
+               isdigit(static_cast<unsigned char>(arg[2]))) {
+      depth = atoi(arg.c_str() + 2);
+    } else if (arg == "--snapshot" && i + 1 < argc) {
+      snapshotFile = argv[++i];
+    } else if (arg == "--diff") {
+      diff = true;
+    } else if (arg == "--prefetch-ids") {
+      IdNameCache::prefetch(); // 一次读入全部用户名与组名
+    } else if (arg == "--no-uring") {
+      DirectoryScanner::setUringEnabled(false); // 逐个调用 statx
+    } else if (arg[0] == '-' && arg.size() > 1) {
+      usage(argv[0]);
+      return 1;
+    } else {
+      path = arg;
+    }
+  }
+  if (threads < 1 || depth < 0 || (diff && snapshotFile.empty()) ||
+      (diskUsage && !snapshotFile.empty())) {
+    usage(argv[0]);
+    return 1;
+  }
+
   DirectoryPrinter printer;
-  printer.listDirectory(path);
-  return 0;
+  if (!snapshotFile.empty() && !printer.useSnapshot(snapshotFile, path, diff))
+    return 1;
+  if (diskUsage)
+    printer.listUsage(path, threads, depth);
+  else if (threads == 1)
+    printer.listDirectory(path);
+  else
+    printer.listDirectoryParallel(path, threads);
+  return printer.saveSnapshot() ? 0 : 1;
 }
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <sched.h>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ThreadPool.h"
+
+// 任务类别：I/O 密集型任务与 CPU 密集型任务分别路由到不同的执行器组
+enum class TaskClass { IO, CPU };
+
+// 解析 sysfs 中的 cpulist 格式，如 "0-3,8-11"
+inline std::vector<int> parseCpuList(const std::string &list) {
+  std::vector<int> cpus;
+  std::stringstream ss(list);
+  std::string range;
+  while (std::getline(ss, range, ',')) {
+    if (range.empty() || range == "\n")
+      continue;
+    size_t dash = range.find('-');
+    int first = std::stoi(range.substr(0, dash));
+    int last =
+        dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+    for (int cpu = first; cpu <= last; ++cpu)
+      cpus.push_back(cpu);
+  }
+  return cpus;
+}
+
+// 读取 NUMA 拓扑，返回每个节点上当前进程允许使用的 CPU 列表
+// 没有 NUMA 信息时，所有允许的 CPU 视为同一个节点
+inline std::vector<std::vector<int>> numaNodes() {
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+      CPU_SET(cpu, &allowed);
+  }
+
+  std::vector<std::vector<int>> nodes;
+  for (int node = 0;; ++node) {
+    std::ifstream in("/sys/devices/system/node/node" + std::to_string(node) +
+                     "/cpulist");
+    if (!in)
+      break;
+    std::string list;
+    std::getline(in, list);
+
+    std::vector<int> cpus;
+    for (int cpu : parseCpuList(list)) {
+      if (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed))
+        cpus.push_back(cpu);
+    }
+    if (!cpus.empty())
+      nodes.push_back(std::move(cpus));
+  }
+
+  if (nodes.empty()) {
+    nodes.emplace_back();
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+      if (CPU_ISSET(cpu, &allowed))
+        nodes.back().push_back(cpu);
+    }
+  }
+  return nodes;
+}
+
+// 按 NUMA 节点轮转排列 CPU，使前 n 个工作线程均匀分布在各个节点上
+inline std::vector<int> interleavedCpus() {
+  std::vector<std::vector<int>> nodes = numaNodes();
+  std::vector<int> cpus;
+  for (size_t i = 0;; ++i) {
+    bool added = false;
+    for (const auto &node : nodes) {
+      if (i < node.size()) {
+        cpus.push_back(node[i]);
+        added = true;
+      }
+    }
+    if (!added)
+      break;
+  }
+  return cpus;
+}
+
+// 执行器组：按名称管理多个线程池，例如受设备队列深度限制的 io 池
+// 和绑定到各个核心上的 cpu 池，任务可以按类别或名称路由
+class Executors {
+public:
+  // 创建默认的 io 与 cpu 两个执行器组
+  // ioDepth 为 io 池的线程数（即同时发往设备的请求数上限）
+  // cpuThreads 为 0 时，cpu 池按可用核心数创建并逐个绑核
+  explicit Executors(size_t ioDepth, size_t cpuThreads = 0) {
+    std::vector<int> cpus = interleavedCpus();
+    if (cpuThreads == 0)
+      cpuThreads = std::max<size_t>(cpus.size(), 1);
+
+    addGroup("io", std::max<size_t>(ioDepth, 1));
+    addGroup("cpu", cpuThreads, cpus);
+  }
+
+  Executors(const Executors &) = delete;
+  Executors &operator=(const Executors &) = delete;
+
+  // 添加一个命名执行器组，cpus 非空时工作线程依次绑定到这些核心
+  ThreadPool &addGroup(const std::string &name, size_t numThreads,
+                       std::vector<int> cpus = {}) {
+    if (groups.count(name) != 0)
+      throw std::runtime_error("Executor group already exists: " + name);
+    auto pool =
+        std::make_unique<ThreadPool>(numThreads, std::move(cpus), name);
+    ThreadPool &ref = *pool;
+    groups.emplace(name, std::move(pool));
+    return ref;
+  }
+
+  // 按名称获取执行器组
+  ThreadPool &group(const std::string &name) {
+    auto it = groups.find(name);
+    if (it == groups.end())
+      throw std::runtime_error("Unknown executor group: " + name);
+    return *it->second;
+  }
+
+  // 按任务类别获取执行器组
+  ThreadPool &operator[](TaskClass cls) {
+    return group(cls == TaskClass::IO ? "io" : "cpu");
+  }
+
+  // 按任务类别提交任务
+  template <typename F, typename... Args>
+  auto enqueue(TaskClass cls, F &&f, Args &&...args) {
+    return (*this)[cls].enqueue(std::forward<F>(f),
+                                std::forward<Args>(args)...);
+  }
+
+  // 按任务类别提交任务，name 为插桩记录中的任务名
+  template <typename F, typename... Args>
+  auto enqueueAs(TaskClass cls, const char *name, F &&f, Args &&...args) {
+    return (*this)[cls].enqueueAs(name, std::forward<F>(f),
+                                  std::forward<Args>(args)...);
+  }
+
+  // 按执行器组名称提交任务
+  template <typename F, typename... Args>
+  auto enqueue(const std::string &name, F &&f, Args &&...args) {
+    return group(name).enqueue(std::forward<F>(f), std::forward<Args>(args)...);
+  }
+
+  // 检查所有执行器组是否都已完成任务
+  bool finish() {
+    for (auto &item : groups) {
+      if (!item.second->finish())
+        return false;
+    }
+    return true;
+  }
+
+private:
+  std::map<std::string, std::unique_ptr<ThreadPool>> groups; // 名称到线程池的映射
+};
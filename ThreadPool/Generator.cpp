@@ -0,0 +1,249 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <random>
+#include <thread>
+
+#include "Generator.h"
+#include "ThreadPool.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// 每次批量写入文件的缓冲区大小
+constexpr size_t WRITE_BUFFER_SIZE = 4 * 1024 * 1024;
+
+// Zipf 分布的取值个数与指数
+constexpr size_t ZIPF_RANKS = 1 << 16;
+constexpr double ZIPF_EXPONENT = 1.1;
+
+// few-distinct 分布中不同数值的个数
+constexpr size_t FEW_DISTINCT_VALUES = 16;
+
+// 两位十进制数字表，格式化时每次处理两位
+const char DIGIT_PAIRS[] = "00010203040506070809101112131415161718192021222324"
+                           "25262728293031323334353637383940414243444546474849"
+                           "50515253545556575859606162636465666768697071727374"
+                           "75767778798081828384858687888990919293949596979899";
+
+// splitmix64 混合函数，用于从种子派生相互独立的子种子和数值
+uint64_t mix64(uint64_t x) {
+  x += 0x9e3779b97f4a7c15ull;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+  return x ^ (x >> 31);
+}
+
+// 按分布生成数值，每个文件一个实例
+class ValueSource {
+public:
+  ValueSource(Distribution distribution, uint64_t seed, uint64_t fileSeed,
+              const std::vector<double> &zipfCdf)
+      : distribution(distribution), seed(seed), rng(fileSeed),
+        zipfCdf(zipfCdf) {}
+
+  int64_t next() {
+    switch (distribution) {
+    case Distribution::Zipf: {
+      double u = unit(rng);
+      size_t rank = std::upper_bound(zipfCdf.begin(), zipfCdf.end(), u) -
+                    zipfCdf.begin();
+      rank = std::min(rank, zipfCdf.size() - 1);
+      return static_cast<int64_t>(mix64(seed ^ rank));
+    }
+    case Distribution::FewDistinct:
+      // 不同文件共享同一组数值
+      return static_cast<int64_t>(mix64(seed + rng() % FEW_DISTINCT_VALUES));
+    case Distribution::AllEqual:
+      return static_cast<int64_t>(mix64(seed));
+    default:
+      return static_cast<int64_t>(rng());
+    }
+  }
+
+private:
+  Distribution distribution;
+  uint64_t seed;
+  std::mt19937_64 rng;
+  std::uniform_real_distribution<double> unit{0.0, 1.0};
+  const std::vector<double> &zipfCdf;
+};
+
+// 预先计算 Zipf 分布的累积概率表，按均匀随机数二分查找得到排名
+std::vector<double> buildZipfCdf() {
+  std::vector<double> cdf(ZIPF_RANKS);
+  double sum = 0;
+  for (size_t k = 0; k < ZIPF_RANKS; ++k) {
+    sum += 1.0 / std::pow(static_cast<double>(k + 1), ZIPF_EXPONENT);
+    cdf[k] = sum;
+  }
+  for (double &p : cdf)
+    p /= sum;
+  return cdf;
+}
+
+// 生成单个文件：数值格式化到大缓冲区中，缓冲区满时整块写入
+void generateFile(const std::string &path, size_t fileSize,
+                  ValueSource source, Distribution distribution) {
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  if (!file.is_open()) {
+    std::cerr << "Failed to open file: " << path << std::endl;
+    return;
+  }
+
+  std::vector<char> buffer(WRITE_BUFFER_SIZE);
+  size_t used = 0;
+  // 追加一个数值，返回写入的字节数
+  auto append = [&](int64_t value) -> size_t {
+    if (used + 21 > buffer.size()) {
+      file.write(buffer.data(), used);
+      used = 0;
+    }
+    size_t length = formatInt64(value, buffer.data() + used);
+    buffer[used + length] = '\n'; // 每个整数后加换行符
+    used += length + 1;
+    return length + 1;
+  };
+
+  char scratch[20];
+  size_t writtenSize = 0; // 已写入的字节数
+  if (distribution == Distribution::Sorted ||
+      distribution == Distribution::Reverse) {
+    // 有序分布需要先生成整个文件的数值再排序
+    std::vector<int64_t> values;
+    while (writtenSize < fileSize) {
+      int64_t value = source.next();
+      writtenSize += formatInt64(value, scratch) + 1;
+      values.push_back(value);
+    }
+    if (distribution == Distribution::Sorted)
+      std::sort(values.begin(), values.end());
+    else
+      std::sort(values.begin(), values.end(), std::greater<int64_t>());
+    for (int64_t value : values)
+      append(value);
+  } else {
+    while (writtenSize < fileSize)
+      writtenSize += append(source.next());
+  }
+
+  file.write(buffer.data(), used);
+  file.close();
+}
+
+} // namespace
+
+bool parseDistribution(const std::string &name, Distribution &distribution) {
+  static const std::pair<const char *, Distribution> names[] = {
+      {"uniform", Distribution::Uniform},
+      {"sorted", Distribution::Sorted},
+      {"reverse", Distribution::Reverse},
+      {"zipf", Distribution::Zipf},
+      {"few-distinct", Distribution::FewDistinct},
+      {"all-equal", Distribution::AllEqual}};
+  for (const auto &item : names) {
+    if (name == item.first) {
+      distribution = item.second;
+      return true;
+    }
+  }
+  return false;
+}
+
+const char *distributionName(Distribution distribution) {
+  switch (distribution) {
+  case Distribution::Sorted:
+    return "sorted";
+  case Distribution::Reverse:
+    return "reverse";
+  case Distribution::Zipf:
+    return "zipf";
+  case Distribution::FewDistinct:
+    return "few-distinct";
+  case Distribution::AllEqual:
+    return "all-equal";
+  default:
+    return "uniform";
+  }
+}
+
+size_t formatInt64(int64_t value, char *out) {
+  char *p = out;
+  uint64_t u = static_cast<uint64_t>(value);
+  if (value < 0) {
+    *p++ = '-';
+    u = 0 - u; // 对 INT64_MIN 同样成立
+  }
+
+  // 从低位向高位每次生成两位数字
+  char digits[20];
+  char *end = digits + sizeof(digits);
+  char *q = end;
+  while (u >= 100) {
+    size_t idx = (u % 100) * 2;
+    u /= 100;
+    q -= 2;
+    std::memcpy(q, DIGIT_PAIRS + idx, 2);
+  }
+  if (u >= 10) {
+    q -= 2;
+    std::memcpy(q, DIGIT_PAIRS + u * 2, 2);
+  } else {
+    *--q = static_cast<char>('0' + u);
+  }
+
+  size_t length = end - q;
+  std::memcpy(p, q, length);
+  return (p - out) + length;
+}
+
+std::vector<std::string> generateFiles(const GeneratorOptions &options) {
+  // 创建输出目录，如果目录已存在则不会重复创建
+  fs::create_directories(options.outputDir);
+
+  // 先按种子顺序决定每个文件的大小
+  std::mt19937_64 rng(options.seed);
+  std::uniform_int_distribution<size_t> fileSizeDist(
+      options.minFileSize, options.maxFileSize); // 随机生成文件大小
+  std::vector<size_t> fileSizes;
+  size_t generatedSize = 0; // 已规划的数据大小
+  while (generatedSize < options.totalSize) {
+    size_t fileSize =
+        std::min(fileSizeDist(rng), options.totalSize - generatedSize);
+    fileSizes.push_back(fileSize);
+    generatedSize += fileSize;
+  }
+
+  std::vector<double> zipfCdf;
+  if (options.distribution == Distribution::Zipf)
+    zipfCdf = buildZipfCdf();
+
+  size_t threads = options.threads;
+  if (threads == 0)
+    threads = std::max(1u, std::thread::hardware_concurrency());
+
+  // 每个文件作为一个任务并行生成
+  std::vector<std::string> paths;
+  std::vector<std::future<void>> futures;
+  {
+    ThreadPool pool(threads);
+    for (size_t i = 0; i < fileSizes.size(); ++i) {
+      std::string path =
+          options.outputDir + "/file_" + std::to_string(i + 1) + ".txt";
+      paths.push_back(path);
+      ValueSource source(options.distribution, options.seed,
+                         mix64(options.seed ^ mix64(i + 1)), zipfCdf);
+      futures.emplace_back(pool.enqueue(generateFile, path, fileSizes[i],
+                                        source, options.distribution));
+    }
+    for (auto &future : futures)
+      future.get();
+  }
+
+  return paths;
+}
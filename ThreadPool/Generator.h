@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// 测试数据的分布类型，用于覆盖排序的不同路径
+enum class Distribution {
+  Uniform,     // 均匀分布的 64 位有符号整数
+  Sorted,      // 每个文件内升序
+  Reverse,     // 每个文件内降序
+  Zipf,        // Zipf 分布，少量数值出现频率极高
+  FewDistinct, // 只有少数几个不同的数值
+  AllEqual     // 所有数值相同
+};
+
+// 数据生成参数
+struct GeneratorOptions {
+  std::string outputDir = "./test";           // 输出目录
+  size_t totalSize = 1ull * 1024 * 1024 * 1024; // 目标总数据量（字节）
+  uint64_t seed = 0;                          // 随机种子，相同种子生成相同数据
+  Distribution distribution = Distribution::Uniform; // 数据分布
+  size_t threads = 0; // 生成线程数，为 0 时使用硬件核心数
+  size_t minFileSize = 50 * 1024;        // 单个文件最小字节数
+  size_t maxFileSize = 50 * 1024 * 1024; // 单个文件最大字节数
+};
+
+// 解析分布名称（uniform、sorted、reverse、zipf、few-distinct、all-equal）
+bool parseDistribution(const std::string &name, Distribution &distribution);
+
+// 返回分布名称
+const char *distributionName(Distribution distribution);
+
+// 将 64 位整数格式化为十进制文本写入 out，返回写入的字节数（不含结尾符）
+// out 至少需要 20 字节
+size_t formatInt64(int64_t value, char *out);
+
+// 并行生成测试数据文件，每行一个整数，返回生成的文件路径
+// 文件大小由种子顺序决定，每个文件的内容使用由种子和文件序号派生的独立随机数，
+// 因此结果与线程数和调度顺序无关
+std::vector<std::string> generateFiles(const GeneratorOptions &options);
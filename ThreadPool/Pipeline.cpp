@@ -0,0 +1,113 @@
+#include <filesystem>
+#include <future>
+#include <mutex>
+
+#include "Pipeline.h"
+#include "Util.h"
+
+namespace fs = std::filesystem;
+
+std::vector<std::string> listInputFiles(const std::string &inputDir) {
+  std::vector<std::string> inputs;
+  for (const auto &entry : fs::directory_iterator(inputDir)) {
+    if (entry.is_directory())
+      continue; // 如果是目录则跳过
+    inputs.push_back(entry.path().string());
+  }
+  return inputs;
+}
+
+std::queue<std::string> splitStage(Executors &executors,
+                                   const std::vector<std::string> &inputs,
+                                   size_t cache_size) {
+  // 使用线程池将所有文件拆分到可一次性读入内存的大小
+  std::vector<std::future<std::vector<std::string>>> futures;
+  for (const auto &inputFile : inputs) {
+    // 将拆分任务添加到 io 执行器组
+    futures.emplace_back(executors.enqueueAs(TaskClass::IO, "splitFile",
+                                             splitFile, inputFile, cache_size));
+  }
+
+  // 等待所有拆分任务完成，并将拆分后的文件路径加入文件队列
+  std::queue<std::string> file_que;
+  for (auto &future : futures) {
+    std::vector<std::string> tempVec = future.get();
+    for (auto &&item : tempVec) {
+      file_que.push(std::move(item));
+    }
+  }
+  return file_que;
+}
+
+std::queue<std::string> sortStage(Executors &executors,
+                                  std::queue<std::string> file_que) {
+  // 使用线程池对拆分后的每个文件进行排序
+  std::vector<std::future<std::string>> futures;
+  while (!file_que.empty()) {
+    // 将排序任务添加到 cpu 执行器组
+    futures.emplace_back(executors.enqueueAs(TaskClass::CPU, "sortFile",
+                                             sortFile, file_que.front()));
+    file_que.pop();
+  }
+
+  // 等待排序完成，将排序后的文件路径重新加入队列
+  for (auto &&future : futures) {
+    file_que.push(std::move(future.get()));
+  }
+  return file_que;
+}
+
+std::string mergeStage(Executors &executors, std::queue<std::string> file_que,
+                       std::queue<std::vector<std::string>> &mergeLog,
+                       size_t cache_size) {
+  // 开始合并排序后的文件
+  std::queue<std::string> &current_que = file_que;
+  std::mutex que_mutex;
+  ThreadPool &pool = executors[TaskClass::IO]; // 合并任务以顺序读写为主
+
+  while (true) {
+    {
+      std::lock_guard<std::mutex> lock(que_mutex);
+      // 如果队列中剩余文件小于2，且线程池没有正在运行的任务，说明合并完成
+      if (current_que.size() < 2) {
+        if (pool.finish())
+          break; // 退出合并循环
+      }
+    }
+
+    std::string firstFile = "", secondFile = "";
+    {
+      std::lock_guard<std::mutex> lock(que_mutex);
+      // 从队列中取出两个文件进行合并
+      if (!current_que.empty()) {
+        firstFile = current_que.front();
+        current_que.pop();
+      }
+    }
+    {
+      std::lock_guard<std::mutex> lock(que_mutex);
+      if (!current_que.empty()) {
+        secondFile = current_que.front();
+        current_que.pop();
+      }
+    }
+
+    // 如果某个文件为空，则重新加入队列
+    if (firstFile == "" || secondFile == "") {
+      std::lock_guard<std::mutex> lock(que_mutex);
+      if (firstFile != "") {
+        current_que.push(firstFile);
+      }
+      if (secondFile != "") {
+        current_que.push(secondFile);
+      }
+    } else if (firstFile != secondFile) {
+      // 否则将合并任务加入线程池
+      pool.enqueueAs("mergeFile", mergeFile, firstFile, secondFile,
+                     std::ref(current_que), std::ref(que_mutex),
+                     std::ref(mergeLog), cache_size);
+    }
+  }
+
+  return current_que.empty() ? "" : current_que.front();
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <queue>
+#include <string>
+#include <vector>
+
+#include "Executor.h"
+
+// 外部排序流水线的各个阶段，供主程序与基准测试共用
+
+// 列出目录下需要处理的文件（跳过子目录）
+std::vector<std::string> listInputFiles(const std::string &inputDir);
+
+// 拆分阶段：在 io 执行器组上将每个输入文件拆分到可一次性读入内存的大小
+std::queue<std::string> splitStage(Executors &executors,
+                                   const std::vector<std::string> &inputs,
+                                   size_t cache_size);
+
+// 排序阶段：在 cpu 执行器组上对每个拆分后的文件排序，并转换为二进制格式
+std::queue<std::string> sortStage(Executors &executors,
+                                  std::queue<std::string> file_que);
+
+// 合并阶段：在 io 执行器组上两两合并已排序的文件，返回最终文件名
+// 队列为空时返回空字符串
+std::string mergeStage(Executors &executors, std::queue<std::string> file_que,
+                       std::queue<std::vector<std::string>> &mergeLog,
+                       size_t cache_size);
@@ -1,69 +1,287 @@
 #pragma once
 
 #include <atomic>
+#include <climits>
 #include <condition_variable>
+#include <cstdint>
+#include <cstdio>
 #include <functional>
 #include <future>
+#include <linux/futex.h>
+#include <memory>
 #include <mutex>
+#include <pthread.h>
 #include <queue>
+#include <string>
+#include <sys/syscall.h>
 #include <thread>
+#include <unistd.h>
 #include <utility>
 #include <vector>
 
-class ThreadPool {
+#include "Trace.h"
+
+using Task = std::function<void()>; // 定义Task类型为无返回值的可调用对象
+
+// 基于 futex 的事件计数器，用于无锁队列上空闲线程的休眠与唤醒
+// 用法：key = prepareWait(); 再次检查条件; 条件不满足则 wait(key)，否则 cancelWait()
+class EventCount {
+public:
+  uint32_t prepareWait() {
+    waiters.fetch_add(1, std::memory_order_seq_cst);
+    return epoch.load(std::memory_order_seq_cst);
+  }
+
+  void cancelWait() { waiters.fetch_sub(1, std::memory_order_seq_cst); }
+
+  void wait(uint32_t key) {
+    // epoch 已变化时 futex 立即返回，不会丢失唤醒
+    if (epoch.load(std::memory_order_seq_cst) == key)
+      syscall(SYS_futex, reinterpret_cast<uint32_t *>(&epoch),
+              FUTEX_WAIT_PRIVATE, key, nullptr, nullptr, 0);
+    waiters.fetch_sub(1, std::memory_order_seq_cst);
+  }
+
+  void notifyOne() { notify(1); }
+  void notifyAll() { notify(INT_MAX); }
+
+private:
+  void notify(int count) {
+    // 没有等待者时只需一次读操作，不触发系统调用
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiters.load(std::memory_order_seq_cst) == 0)
+      return;
+    epoch.fetch_add(1, std::memory_order_seq_cst);
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(&epoch), FUTEX_WAKE_PRIVATE,
+            count, nullptr, nullptr, 0);
+  }
+
+  std::atomic<uint32_t> epoch{0};   // 每次唤醒递增
+  std::atomic<uint32_t> waiters{0}; // 正在等待的线程数
+};
+
+// 默认的任务队列后端：std::queue + 互斥锁 + 条件变量
+class MutexTaskQueue {
+public:
+  // 添加任务，线程池已停止时返回 false
+  bool push(Task &&task, const std::atomic<bool> &stop) {
+    {
+      std::unique_lock<std::mutex> lock(queueMutex); // 锁住队列
+      if (stop.load())
+        return false;
+      tasks.emplace(std::move(task));
+    }
+    condition.notify_one(); // 唤醒一个等待中的线程来执行任务
+    return true;
+  }
+
+  // 取出任务，线程池停止且队列为空时返回 false
+  bool pop(Task &task, const std::atomic<bool> &stop) {
+    std::unique_lock<std::mutex> lock(queueMutex);
+    // 等待直到有任务或线程池停止
+    condition.wait(lock, [&]() { return stop.load() || !tasks.empty(); });
+
+    // 如果线程池停止且任务队列为空，则退出线程
+    if (stop.load() && tasks.empty())
+      return false;
+
+    // 从任务队列中取出一个任务
+    task = std::move(tasks.front());
+    tasks.pop();
+    return true;
+  }
+
+  // 唤醒所有等待中的线程
+  void wakeAll() {
+    std::lock_guard<std::mutex> lock(queueMutex);
+    condition.notify_all();
+  }
+
+private:
+  std::queue<Task> tasks;            // 存储待执行的任务队列
+  std::mutex queueMutex;             // 用于保护任务队列的互斥锁
+  std::condition_variable condition; // 条件变量，用于线程间同步
+};
+
+// 有界无锁 MPMC 环形队列后端（Vyukov 算法），提交与取出都不加锁
+// Capacity 必须是 2 的幂，队列满时提交方休眠等待空位
+template <size_t Capacity = 4096> class RingTaskQueue {
+  static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                "RingTaskQueue capacity must be a power of two");
+
+public:
+  RingTaskQueue() : cells(new Cell[Capacity]) {
+    for (size_t i = 0; i < Capacity; ++i)
+      cells[i].seq.store(i, std::memory_order_relaxed);
+  }
+
+  bool push(Task &&task, const std::atomic<bool> &stop) {
+    if (stop.load())
+      return false;
+    for (int spins = 0; !tryPush(task); ++spins) {
+      // 队列满时先让出 CPU 给消费者，仍然满再休眠等待空位
+      if (spins < SPIN_COUNT) {
+        std::this_thread::yield();
+        continue;
+      }
+      uint32_t key = notFull.prepareWait();
+      if (tryPush(task)) {
+        notFull.cancelWait();
+        break;
+      }
+      notFull.wait(key);
+    }
+    notEmpty.notifyOne();
+    return true;
+  }
+
+  bool pop(Task &task, const std::atomic<bool> &stop) {
+    // 先短暂自旋，避免短任务流中频繁进入 futex
+    for (int i = 0; i < SPIN_COUNT; ++i) {
+      if (tryPop(task)) {
+        notFull.notifyOne();
+        return true;
+      }
+    }
+
+    while (true) {
+      uint32_t key = notEmpty.prepareWait();
+      if (tryPop(task)) {
+        notEmpty.cancelWait();
+        notFull.notifyOne();
+        return true;
+      }
+      if (stop.load()) {
+        notEmpty.cancelWait();
+        return false;
+      }
+      notEmpty.wait(key);
+    }
+  }
+
+  void wakeAll() { notEmpty.notifyAll(); }
+
+private:
+  struct Cell {
+    std::atomic<size_t> seq; // 槽位序号，用于判断槽位可写或可读
+    Task task;
+  };
+
+  bool tryPush(Task &task) {
+    size_t pos = enqueuePos.load(std::memory_order_relaxed);
+    while (true) {
+      Cell &cell = cells[pos & (Capacity - 1)];
+      size_t seq = cell.seq.load(std::memory_order_acquire);
+      intptr_t dif = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+      if (dif == 0) {
+        if (enqueuePos.compare_exchange_weak(pos, pos + 1,
+                                             std::memory_order_relaxed)) {
+          cell.task = std::move(task);
+          cell.seq.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (dif < 0) {
+        return false; // 队列已满
+      } else {
+        pos = enqueuePos.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  bool tryPop(Task &task) {
+    size_t pos = dequeuePos.load(std::memory_order_relaxed);
+    while (true) {
+      Cell &cell = cells[pos & (Capacity - 1)];
+      size_t seq = cell.seq.load(std::memory_order_acquire);
+      intptr_t dif =
+          static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+      if (dif == 0) {
+        if (dequeuePos.compare_exchange_weak(pos, pos + 1,
+                                             std::memory_order_relaxed)) {
+          task = std::move(cell.task);
+          cell.task = nullptr;
+          cell.seq.store(pos + Capacity, std::memory_order_release);
+          return true;
+        }
+      } else if (dif < 0) {
+        return false; // 队列为空
+      } else {
+        pos = dequeuePos.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  static constexpr int SPIN_COUNT = 64;
+
+  std::unique_ptr<Cell[]> cells;                // 环形槽位数组
+  alignas(64) std::atomic<size_t> enqueuePos{0}; // 下一个写入位置
+  alignas(64) std::atomic<size_t> dequeuePos{0}; // 下一个读取位置
+  alignas(64) EventCount notEmpty;               // 空闲工作线程在此休眠
+  EventCount notFull;                            // 队列满时提交方在此休眠
+};
+
+// 线程池，任务队列后端通过模板参数选择
+template <typename Queue> class BasicThreadPool {
 public:
   // 构造函数，初始化线程池，创建指定数量的工作线程
-  explicit ThreadPool(size_t numThreads) : stop(false), runningTasks(0) {
+  // cpus 非空时，第 i 个工作线程绑定到 cpus[i % cpus.size()] 对应的核心上
+  // name 用于插桩输出中区分不同的线程池
+  explicit BasicThreadPool(size_t numThreads, std::vector<int> cpus = {},
+                           const std::string &name = "pool")
+      : stop(false), pendingTasks(0), traceId(trace::registerPool(name)) {
     // 创建指定数量的工作线程
     for (size_t i = 0; i < numThreads; ++i) {
-      workers.emplace_back([this]() {
-        while (true) {
-          Task task;
-          {
-            std::unique_lock<std::mutex> lock(queueMutex);
-            // 等待直到有任务或线程池停止
-            condition.wait(lock,
-                           [this]() { return stop.load() || !tasks.empty(); });
-
-            // 如果线程池停止且任务队列为空，则退出线程
-            if (stop.load() && tasks.empty())
-              return;
-
-            // 从任务队列中取出一个任务
-            task = std::move(tasks.front());
-            tasks.pop();
-          }
-
-          // 增加当前正在运行的任务计数
-          runningTasks.fetch_add(1, std::memory_order_relaxed);
+      int cpu = cpus.empty() ? -1 : cpus[i % cpus.size()];
+      workers.emplace_back([this, cpu, i]() {
+        // 先绑核再取任务，任务中分配的缓冲区按首次访问落在本地 NUMA 节点上
+        if (cpu >= 0)
+          pinCurrentThread(cpu);
+        trace::setWorker(traceId, static_cast<uint32_t>(i));
+
+        Task task;
+        while (tasks.pop(task, stop)) {
           task(); // 执行任务
-          // 任务完成后减少正在运行的任务计数
-          runningTasks.fetch_sub(1, std::memory_order_relaxed);
+          task = nullptr;
+          // 任务完成后减少未完成的任务计数
+          size_t pending =
+              pendingTasks.fetch_sub(1, std::memory_order_acq_rel) - 1;
+          if (trace::enabled())
+            trace::recordDepth(traceId, pending);
         }
       });
     }
   }
 
   // 析构函数，停止线程池并等待所有线程完成工作
-  ~ThreadPool() {
-    stop.store(true);       // 标记线程池停止
-    condition.notify_all(); // 通知所有线程退出
+  ~BasicThreadPool() {
+    stop.store(true); // 标记线程池停止
+    tasks.wakeAll();  // 通知所有线程退出
     for (std::thread &worker : workers) {
       worker.join(); // 等待所有线程完成
     }
   }
 
+  BasicThreadPool(const BasicThreadPool &) = delete;
+  BasicThreadPool &operator=(const BasicThreadPool &) = delete;
+
   // 检查线程池是否完成所有任务
   bool finish() {
-    std::lock_guard<std::mutex> lock(queueMutex);
-    // 判断任务队列是否为空且当前没有正在运行的任务
-    return runningTasks.load(std::memory_order_relaxed) == 0 && tasks.empty();
+    // 计数在入队前增加、执行完后减少，因此不存在任务已出队但尚未计数的窗口
+    return pendingTasks.load(std::memory_order_acquire) == 0;
   }
 
   // 向线程池添加一个新的任务，返回一个future，用于获取任务的执行结果
   template <typename F, typename... Args>
   auto enqueue(F &&f, Args &&...args) -> std::future<decltype(std::forward<F>(
                                           f)(std::forward<Args>(args)...))> {
+    return enqueueAs("task", std::forward<F>(f), std::forward<Args>(args)...);
+  }
+
+  // 同 enqueue，name 为插桩记录中的任务名，须为静态字符串
+  template <typename F, typename... Args>
+  auto enqueueAs(const char *name, F &&f, Args &&...args)
+      -> std::future<decltype(std::forward<F>(f)(
+          std::forward<Args>(args)...))> {
     using ReturnType = decltype(std::forward<F>(f)(
         std::forward<Args>(args)...)); // 任务返回值类型
 
@@ -73,26 +291,53 @@ public:
 
     // 获取任务的future，任务完成时可以获取返回值
     std::future<ReturnType> result = task->get_future();
-    {
-      std::unique_lock<std::mutex> lock(queueMutex); // 锁住队列
-      if (stop.load()) { // 如果线程池已经停止，抛出异常
-        throw std::runtime_error(
-            "ThreadPool is stopped, cannot enqueue tasks.");
-      }
-      // 将任务添加到队列中
-      tasks.emplace([task]() { (*task)(); });
+    post([task]() { (*task)(); }, name);
+    return result; // 返回future，用于获取任务结果
+  }
+
+  // 添加一个不需要返回值的任务，省去 packaged_task 与 future 的开销
+  void post(Task task, const char *name = "task") {
+    if (trace::enabled()) {
+      // 启用插桩时记录提交时间，执行时统计等待、运行时间与读写字节数
+      task = [inner = std::move(task), name, enqueueNs = trace::nowNs()]() {
+        trace::TaskScope scope(name, enqueueNs);
+        inner();
+      };
+    }
+
+    size_t pending = pendingTasks.fetch_add(1, std::memory_order_acq_rel) + 1;
+    if (trace::enabled())
+      trace::recordDepth(traceId, pending);
+    if (!tasks.push(std::move(task), stop)) {
+      pendingTasks.fetch_sub(1, std::memory_order_acq_rel);
+      // 如果线程池已经停止，抛出异常
+      throw std::runtime_error("ThreadPool is stopped, cannot enqueue tasks.");
     }
-    condition.notify_one(); // 唤醒一个等待中的线程来执行任务
-    return result;          // 返回future，用于获取任务结果
   }
 
-private:
-  using Task = std::function<void()>; // 定义Task类型为无返回值的可调用对象
+  // 将当前线程绑定到指定的 CPU 核心
+  static bool pinCurrentThread(int cpu) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    int r = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (r != 0) {
+      std::fprintf(stderr, "ThreadPool: 无法绑定到 CPU %d\n", cpu);
+      return false;
+    }
+    return true;
+  }
 
-  std::vector<std::thread> workers;  // 存储线程池中的工作线程
-  std::queue<Task> tasks;            // 存储待执行的任务队列
-  std::mutex queueMutex;             // 用于保护任务队列的互斥锁
-  std::condition_variable condition; // 条件变量，用于线程间同步
+private:
+  std::vector<std::thread> workers; // 存储线程池中的工作线程
+  Queue tasks;                      // 任务队列后端
   std::atomic<bool> stop; // 原子标志，表示线程池是否停止
-  std::atomic<size_t> runningTasks; // 原子计数器，表示当前正在运行的任务数量
-};
\ No newline at end of file
+  std::atomic<size_t> pendingTasks; // 原子计数器，表示已提交但尚未完成的任务数量
+  uint32_t traceId;                 // 插桩记录中的线程池编号
+};
+
+// 默认线程池：互斥锁 + 条件变量队列
+using ThreadPool = BasicThreadPool<MutexTaskQueue>;
+
+// 无锁线程池：有界 MPMC 环形队列，空闲线程通过 futex 休眠
+using LockFreeThreadPool = BasicThreadPool<RingTaskQueue<>>;
@@ -0,0 +1,340 @@
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "Trace.h"
+
+namespace trace {
+
+std::atomic<bool> gEnabled(false);
+
+namespace {
+
+// 一次任务执行的记录
+struct TaskEvent {
+  const char *name;
+  uint32_t pool;
+  uint32_t worker;
+  uint64_t enqueueNs;
+  uint64_t startNs;
+  uint64_t endNs;
+  uint64_t bytesRead;
+  uint64_t bytesWritten;
+};
+
+// 一次队列深度采样
+struct DepthSample {
+  uint32_t pool;
+  uint64_t ts;
+  uint64_t depth;
+};
+
+// 每个线程独立的记录缓冲区，记录时无需加锁
+struct ThreadBuffer {
+  uint32_t pool = 0;
+  uint32_t worker = 0;
+  ThreadCounters counters;
+  std::vector<TaskEvent> tasks;
+  std::vector<DepthSample> depths;
+};
+
+std::mutex gMutex; // 保护下面的全局注册表
+std::vector<std::unique_ptr<ThreadBuffer>> gBuffers;
+std::vector<std::string> gPools = {"main"};
+uint64_t gStartNs = 0;
+uint64_t gStopNs = 0;
+
+ThreadBuffer &threadBuffer() {
+  thread_local ThreadBuffer *buffer = nullptr;
+  if (buffer == nullptr) {
+    std::lock_guard<std::mutex> lock(gMutex);
+    gBuffers.push_back(std::make_unique<ThreadBuffer>());
+    buffer = gBuffers.back().get();
+  }
+  return *buffer;
+}
+
+// 汇总所有线程的任务记录
+std::vector<TaskEvent> collectTasks() {
+  std::vector<TaskEvent> tasks;
+  std::lock_guard<std::mutex> lock(gMutex);
+  for (const auto &buffer : gBuffers)
+    tasks.insert(tasks.end(), buffer->tasks.begin(), buffer->tasks.end());
+  std::sort(tasks.begin(), tasks.end(),
+            [](const TaskEvent &a, const TaskEvent &b) {
+              return a.startNs < b.startNs;
+            });
+  return tasks;
+}
+
+// 已排序数组的分位数
+uint64_t percentile(const std::vector<uint64_t> &sorted, double p) {
+  if (sorted.empty())
+    return 0;
+  size_t idx = static_cast<size_t>(p * (sorted.size() - 1) + 0.5);
+  return sorted[std::min(idx, sorted.size() - 1)];
+}
+
+// 以合适的单位输出时长
+std::string formatNs(uint64_t ns) {
+  char buf[32];
+  if (ns < 1000)
+    snprintf(buf, sizeof(buf), "%luns", static_cast<unsigned long>(ns));
+  else if (ns < 1000000)
+    snprintf(buf, sizeof(buf), "%.1fus", ns / 1e3);
+  else if (ns < 1000000000)
+    snprintf(buf, sizeof(buf), "%.1fms", ns / 1e6);
+  else
+    snprintf(buf, sizeof(buf), "%.2fs", ns / 1e9);
+  return buf;
+}
+
+// 以 2 的幂为桶宽输出时长直方图
+void printHistogram(std::ostream &out, const char *title,
+                    const std::vector<uint64_t> &values) {
+  size_t buckets[64] = {0};
+  size_t maxCount = 0;
+  int low = 63, high = 0;
+  for (uint64_t v : values) {
+    int b = v == 0 ? 0 : 63 - __builtin_clzll(v);
+    maxCount = std::max(maxCount, ++buckets[b]);
+    low = std::min(low, b);
+    high = std::max(high, b);
+  }
+  out << title << " histogram:\n";
+  for (int b = low; b <= high && maxCount > 0; ++b) {
+    size_t bar = buckets[b] * 40 / maxCount;
+    out << "  [" << std::setw(8) << formatNs(1ull << b) << ", "
+        << std::setw(8) << formatNs(2ull << b) << ") " << std::setw(8)
+        << buckets[b] << " " << std::string(bar, '#') << "\n";
+  }
+}
+
+} // namespace
+
+ThreadCounters &threadCounters() { return threadBuffer().counters; }
+
+void start() {
+  std::lock_guard<std::mutex> lock(gMutex);
+  for (auto &buffer : gBuffers) {
+    buffer->tasks.clear();
+    buffer->depths.clear();
+  }
+  gStartNs = nowNs();
+  gStopNs = 0;
+  gEnabled.store(true);
+}
+
+void stop() {
+  gEnabled.store(false);
+  std::lock_guard<std::mutex> lock(gMutex);
+  gStopNs = nowNs();
+}
+
+uint32_t registerPool(const std::string &name) {
+  std::lock_guard<std::mutex> lock(gMutex);
+  // 同名的线程池共用一个编号，反复创建线程池时列表不会增长
+  for (size_t i = 1; i < gPools.size(); ++i)
+    if (gPools[i] == name)
+      return static_cast<uint32_t>(i);
+  gPools.push_back(name);
+  return static_cast<uint32_t>(gPools.size() - 1);
+}
+
+void setWorker(uint32_t pool, uint32_t worker) {
+  ThreadBuffer &buffer = threadBuffer();
+  buffer.pool = pool;
+  buffer.worker = worker;
+}
+
+void recordTask(const char *name, uint64_t enqueueNs, uint64_t startNs,
+                uint64_t endNs, const ThreadCounters &io) {
+  if (!enabled())
+    return;
+  ThreadBuffer &buffer = threadBuffer();
+  buffer.tasks.push_back({name, buffer.pool, buffer.worker, enqueueNs, startNs,
+                          endNs, io.bytesRead, io.bytesWritten});
+}
+
+void recordDepth(uint32_t pool, uint64_t depth) {
+  if (!enabled())
+    return;
+  threadBuffer().depths.push_back({pool, nowNs(), depth});
+}
+
+bool writeChromeTrace(const std::string &path) {
+  std::ofstream out(path, std::ios::trunc);
+  if (!out)
+    return false;
+
+  std::vector<TaskEvent> tasks = collectTasks();
+  std::lock_guard<std::mutex> lock(gMutex);
+
+  // 时间戳以开始记录的时刻为零点，单位微秒
+  auto us = [](uint64_t ns) { return (ns - gStartNs) / 1000.0; };
+  bool first = true;
+  auto sep = [&]() -> std::ostream & {
+    out << (first ? "\n  " : ",\n  ");
+    first = false;
+    return out;
+  };
+
+  out << std::fixed << std::setprecision(3) << "{\"traceEvents\": [";
+
+  // 线程名元数据：每个线程池一个 pid 下的若干工作线程
+  for (size_t p = 0; p < gPools.size(); ++p) {
+    sep() << "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": " << p
+          << ", \"args\": {\"name\": \"" << gPools[p] << "\"}}";
+  }
+  for (const auto &buffer : gBuffers) {
+    sep() << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": "
+          << buffer->pool << ", \"tid\": " << buffer->worker
+          << ", \"args\": {\"name\": \"" << gPools[buffer->pool] << "-"
+          << buffer->worker << "\"}}";
+  }
+
+  for (const auto &t : tasks) {
+    sep() << "{\"name\": \"" << t.name << "\", \"cat\": \"" << gPools[t.pool]
+          << "\", \"ph\": \"X\", \"pid\": " << t.pool
+          << ", \"tid\": " << t.worker << ", \"ts\": " << us(t.startNs)
+          << ", \"dur\": " << (t.endNs - t.startNs) / 1000.0
+          << ", \"args\": {\"wait_us\": " << (t.startNs - t.enqueueNs) / 1000.0
+          << ", \"bytes_read\": " << t.bytesRead
+          << ", \"bytes_written\": " << t.bytesWritten << "}}";
+  }
+
+  for (const auto &buffer : gBuffers) {
+    for (const auto &d : buffer->depths) {
+      sep() << "{\"name\": \"queue depth\", \"ph\": \"C\", \"pid\": "
+            << d.pool << ", \"ts\": " << us(d.ts)
+            << ", \"args\": {\"depth\": " << d.depth << "}}";
+    }
+  }
+
+  out << "\n]}\n";
+  return static_cast<bool>(out);
+}
+
+void printSummary(std::ostream &out) {
+  std::vector<TaskEvent> tasks = collectTasks();
+  std::lock_guard<std::mutex> lock(gMutex);
+  uint64_t stopNs = gStopNs != 0 ? gStopNs : nowNs();
+  uint64_t window = std::max<uint64_t>(stopNs - gStartNs, 1);
+
+  // 按任务名统计（主线程上的区间单独列出，不计入等待时间）
+  std::map<std::string, std::vector<const TaskEvent *>> byName;
+  std::vector<uint64_t> allWaits, allRuns;
+  for (const auto &t : tasks) {
+    byName[t.name].push_back(&t);
+    if (t.pool != 0) {
+      allWaits.push_back(t.startNs - t.enqueueNs);
+      allRuns.push_back(t.endNs - t.startNs);
+    }
+  }
+
+  out << std::left << std::setw(16) << "task" << std::right << std::setw(8)
+      << "count" << std::setw(10) << "wait p50" << std::setw(10) << "wait p99"
+      << std::setw(10) << "wait max" << std::setw(10) << "run p50"
+      << std::setw(10) << "run p99" << std::setw(10) << "run max"
+      << std::setw(10) << "read MB" << std::setw(10) << "write MB" << "\n";
+  for (auto &item : byName) {
+    std::vector<uint64_t> waits, runs;
+    uint64_t bytesRead = 0, bytesWritten = 0;
+    for (const TaskEvent *t : item.second) {
+      waits.push_back(t->startNs - t->enqueueNs);
+      runs.push_back(t->endNs - t->startNs);
+      bytesRead += t->bytesRead;
+      bytesWritten += t->bytesWritten;
+    }
+    std::sort(waits.begin(), waits.end());
+    std::sort(runs.begin(), runs.end());
+    out << std::left << std::setw(16) << item.first << std::right
+        << std::setw(8) << runs.size() << std::setw(10)
+        << formatNs(percentile(waits, 0.5)) << std::setw(10)
+        << formatNs(percentile(waits, 0.99)) << std::setw(10)
+        << formatNs(waits.back()) << std::setw(10)
+        << formatNs(percentile(runs, 0.5)) << std::setw(10)
+        << formatNs(percentile(runs, 0.99)) << std::setw(10)
+        << formatNs(runs.back()) << std::fixed << std::setprecision(1)
+        << std::setw(10) << bytesRead / 1048576.0 << std::setw(10)
+        << bytesWritten / 1048576.0 << "\n";
+  }
+  out << "\n";
+  printHistogram(out, "Queue wait", allWaits);
+  printHistogram(out, "Run time", allRuns);
+
+  // 最慢的几个任务，用于定位拖尾
+  std::vector<const TaskEvent *> slowest;
+  for (const auto &t : tasks) {
+    if (t.pool != 0)
+      slowest.push_back(&t);
+  }
+  std::sort(slowest.begin(), slowest.end(),
+            [](const TaskEvent *a, const TaskEvent *b) {
+              return a->endNs - a->startNs > b->endNs - b->startNs;
+            });
+  out << "\nSlowest tasks:\n";
+  for (size_t i = 0; i < std::min<size_t>(slowest.size(), 5); ++i) {
+    const TaskEvent *t = slowest[i];
+    out << "  " << std::left << std::setw(16) << t->name << std::right
+        << std::setw(10) << formatNs(t->endNs - t->startNs) << "  on "
+        << gPools[t->pool] << "-" << t->worker << " at +"
+        << formatNs(t->startNs - gStartNs) << "\n";
+  }
+
+  // 工作线程利用率与最长空闲间隔
+  std::map<std::pair<uint32_t, uint32_t>, std::vector<const TaskEvent *>>
+      byWorker;
+  for (const auto &t : tasks) {
+    if (t.pool != 0)
+      byWorker[{t.pool, t.worker}].push_back(&t);
+  }
+  out << "\n"
+      << std::left << std::setw(16) << "worker" << std::right << std::setw(8)
+      << "tasks" << std::setw(10) << "busy" << std::setw(8) << "util%"
+      << std::setw(12) << "max idle" << "\n";
+  for (auto &item : byWorker) {
+    uint64_t busy = 0, maxIdle = 0, last = gStartNs;
+    for (const TaskEvent *t : item.second) {
+      busy += t->endNs - t->startNs;
+      if (t->startNs > last)
+        maxIdle = std::max(maxIdle, t->startNs - last);
+      last = std::max(last, t->endNs);
+    }
+    out << std::left << std::setw(16)
+        << gPools[item.first.first] + "-" + std::to_string(item.first.second)
+        << std::right << std::setw(8) << item.second.size() << std::setw(10)
+        << formatNs(busy) << std::setw(8) << std::fixed << std::setprecision(1)
+        << 100.0 * busy / window << std::setw(12) << formatNs(maxIdle) << "\n";
+  }
+
+  // 每个线程池的队列深度
+  std::map<uint32_t, std::pair<uint64_t, std::pair<uint64_t, size_t>>> depth;
+  for (const auto &buffer : gBuffers) {
+    for (const auto &d : buffer->depths) {
+      auto &entry = depth[d.pool];
+      entry.first = std::max(entry.first, d.depth);
+      entry.second.first += d.depth;
+      entry.second.second += 1;
+    }
+  }
+  out << "\n"
+      << std::left << std::setw(16) << "pool" << std::right << std::setw(10)
+      << "samples" << std::setw(10) << "depth max" << std::setw(12)
+      << "depth mean" << "\n";
+  for (auto &item : depth) {
+    out << std::left << std::setw(16) << gPools[item.first] << std::right
+        << std::setw(10) << item.second.second.second << std::setw(10)
+        << item.second.first << std::setw(12) << std::fixed
+        << std::setprecision(1)
+        << static_cast<double>(item.second.second.first) /
+               item.second.second.second
+        << "\n";
+  }
+}
+
+} // namespace trace
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+// 线程池与流水线的运行时插桩：
+// 记录每个任务的排队等待时间、运行时间与所在工作线程，队列深度采样，
+// 以及 Util.cpp 中各函数的读写字节数；结果可导出为 Chrome trace-event JSON
+// （chrome://tracing 或 Perfetto 打开）和汇总表。
+// 未启用时，每个插桩点只有一次 relaxed 原子读和一个分支。
+namespace trace {
+
+extern std::atomic<bool> gEnabled;
+
+// 是否正在记录
+inline bool enabled() { return gEnabled.load(std::memory_order_relaxed); }
+
+// 单调时钟，单位纳秒
+inline uint64_t nowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// 当前线程上正在执行的任务累计的读写字节数
+struct ThreadCounters {
+  uint64_t bytesRead = 0;
+  uint64_t bytesWritten = 0;
+};
+
+ThreadCounters &threadCounters();
+
+// Util.cpp 中的 I/O 函数调用，统计读写字节数
+inline void addRead(size_t bytes) {
+  if (enabled())
+    threadCounters().bytesRead += bytes;
+}
+
+inline void addWritten(size_t bytes) {
+  if (enabled())
+    threadCounters().bytesWritten += bytes;
+}
+
+// 开始记录（清空之前的记录）
+void start();
+
+// 停止记录
+void stop();
+
+// 注册一个线程池，返回其编号；编号 0 保留给主线程，同名的线程池编号相同
+uint32_t registerPool(const std::string &name);
+
+// 标记当前线程为某个线程池的第 worker 个工作线程
+void setWorker(uint32_t pool, uint32_t worker);
+
+// 记录当前线程上一个任务的执行，enqueueNs 为提交时间
+void recordTask(const char *name, uint64_t enqueueNs, uint64_t startNs,
+                uint64_t endNs, const ThreadCounters &io);
+
+// 记录一个线程池的队列深度采样（已提交但尚未完成的任务数）
+void recordDepth(uint32_t pool, uint64_t depth);
+
+// 将记录导出为 Chrome trace-event JSON，应在工作线程空闲后调用
+bool writeChromeTrace(const std::string &path);
+
+// 输出汇总表：按任务名统计等待与运行时间分布、读写字节数，
+// 按工作线程统计利用率，按线程池统计队列深度
+void printSummary(std::ostream &out);
+
+// 包装一次任务执行：构造时记录开始时间与 I/O 计数，析构时提交记录
+class TaskScope {
+public:
+  TaskScope(const char *name, uint64_t enqueueNs)
+      : name(name), enqueueNs(enqueueNs), startNs(nowNs()),
+        before(threadCounters()) {}
+
+  ~TaskScope() {
+    ThreadCounters after = threadCounters();
+    ThreadCounters io;
+    io.bytesRead = after.bytesRead - before.bytesRead;
+    io.bytesWritten = after.bytesWritten - before.bytesWritten;
+    recordTask(name, enqueueNs, startNs, nowNs(), io);
+  }
+
+  TaskScope(const TaskScope &) = delete;
+  TaskScope &operator=(const TaskScope &) = delete;
+
+private:
+  const char *name;
+  uint64_t enqueueNs;
+  uint64_t startNs;
+  ThreadCounters before;
+};
+
+// 在调用线程上记录一个区间（例如主线程上的各个流水线阶段）
+class Span {
+public:
+  explicit Span(const char *name) : name(enabled() ? name : nullptr) {
+    if (this->name != nullptr) {
+      startNs = nowNs();
+      before = threadCounters();
+    }
+  }
+
+  ~Span() {
+    if (name == nullptr)
+      return;
+    ThreadCounters after = threadCounters();
+    ThreadCounters io;
+    io.bytesRead = after.bytesRead - before.bytesRead;
+    io.bytesWritten = after.bytesWritten - before.bytesWritten;
+    recordTask(name, startNs, startNs, nowNs(), io);
+  }
+
+  Span(const Span &) = delete;
+  Span &operator=(const Span &) = delete;
+
+private:
+  const char *name; // 未启用时为空，析构时不做任何事
+  uint64_t startNs = 0;
+  ThreadCounters before;
+};
+
+} // namespace trace
@@ -10,6 +10,7 @@
 #include <string>
 #include <vector>
 
+#include "Trace.h"
 #include "Util.h"
 
 namespace fs = std::filesystem;
@@ -30,6 +31,7 @@ void readFile(std::vector<char> &read_cache, std::vector<int64_t> &cache,
 
   inFile.read(read_cache.data(), size);
   size_t bytesRead = inFile.gcount();
+  trace::addRead(bytesRead);
 
   // 将读取的数据解析成 int64_t 格式
   for (size_t i = 0; i + sizeof(int64_t) + sizeof(DELIMITER) <= bytesRead;
@@ -104,6 +106,7 @@ void mergeFile(std::string first, std::string second,
 
       outFile.write(reinterpret_cast<const char *>(write_cache.data()),
                     write_cache.size()); // 将已缓存的数据写入文件
+      trace::addWritten(write_cache.size());
       write_cache.clear();               // 清空写入缓存
     }
     // 如果缓存2已读完，从文件2中读取新的数据
@@ -116,6 +119,7 @@ void mergeFile(std::string first, std::string second,
 
       outFile.write(reinterpret_cast<const char *>(write_cache.data()),
                     write_cache.size()); // 将已缓存的数据写入文件
+      trace::addWritten(write_cache.size());
       write_cache.clear();               // 清空写入缓存
     }
 
@@ -213,6 +217,7 @@ std::string sortFile(std::string filename) {
   std::string buff;
   buff.resize(buffer_size); // 预先为读取的数据分配内存
   input_file.read(&buff[0], buffer_size); // 批量读取文件内容
+  trace::addRead(input_file.gcount());
   std::istringstream ssin(buff); // 使用字符串流将文件内容转为可处理的流
   while (ssin >> number) { // 逐个读取64位整数并存储到vector中
     data.push_back(number);
@@ -247,6 +252,7 @@ std::string sortFile(std::string filename) {
         DELIMITER); // 为了方便debug, 在中间文件中加入文本文件类似的分隔符
   }
   output_file.write(cache.data(), cache.size()); // 将缓存中的数据写入文件
+  trace::addWritten(cache.size());
   output_file.close();
 
   return filename;
@@ -301,6 +307,8 @@ std::vector<std::string> splitFile(std::string filename, size_t file_size) {
     std::vector<char> buffer(current_part_size);
     input_file.read(buffer.data(), current_part_size);
     output_file.write(buffer.data(), current_part_size);
+    trace::addRead(input_file.gcount());
+    trace::addWritten(current_part_size);
     output_file.close();
   }
 
@@ -320,8 +328,10 @@ std::string bin2Text(std::string origin_file, size_t cache_size) {
   std::vector<char> buffer(cache_size);
   std::vector<int64_t> data;
   int64_t number;
-  while (inFile.read(buffer.data(), buffer.size())) {
+  // 最后一次读到的不足一整块，read 返回失败但 gcount 不为 0
+  while (inFile.read(buffer.data(), buffer.size()) || inFile.gcount() > 0) {
     size_t bytesRead = inFile.gcount();
+    trace::addRead(bytesRead);
     for (int i = 0; i + sizeof(int64_t) + sizeof(DELIMITER) <= bytesRead;
          i += sizeof(int64_t) + sizeof(DELIMITER)) {
       std::memcpy(&number, &buffer[i], sizeof(int64_t));
@@ -333,10 +343,17 @@ std::string bin2Text(std::string origin_file, size_t cache_size) {
   for (size_t i = 0; i < data.size(); ++i) {
     buff << data[i] << DELIMITER;
     if (i != 0 && i % (cache_size * 1024 / sizeof(int64_t)) == 0) {
-      outFile << buff.str();
+      // 写出后清空缓冲，只统计本次写出的字节数
+      std::string text = buff.str();
+      outFile << text;
+      trace::addWritten(text.size());
+      buff.str("");
+      buff.clear();
     }
   }
-  outFile << buff.str();
+  std::string text = buff.str();
+  outFile << text;
+  trace::addWritten(text.size());
 
   outFile.close();
   inFile.close();
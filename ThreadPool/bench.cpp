@@ -0,0 +1,360 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Executor.h"
+#include "Generator.h"
+#include "Pipeline.h"
+#include "Util.h"
+
+namespace fs = std::filesystem;
+
+// 外部排序流水线的端到端基准测试：
+// 对不同数据量、缓存大小与线程数的组合分别运行拆分、排序、合并和 bin2Text，
+// 报告每个阶段与整条流水线的 MB/s、records/s、读写字节数和峰值内存，
+// 并输出 JSON 以便比较不同构建之间的结果
+
+// 进程级 I/O 计数器，来自 /proc/self/io
+struct IoCounters {
+  uint64_t rchar = 0;      // read 类系统调用读取的字节数（含页缓存命中）
+  uint64_t wchar = 0;      // write 类系统调用写入的字节数
+  uint64_t readBytes = 0;  // 实际从存储设备读取的字节数
+  uint64_t writeBytes = 0; // 实际提交到存储设备的字节数
+
+  IoCounters operator-(const IoCounters &other) const {
+    IoCounters d;
+    d.rchar = rchar - other.rchar;
+    d.wchar = wchar - other.wchar;
+    d.readBytes = readBytes - other.readBytes;
+    d.writeBytes = writeBytes - other.writeBytes;
+    return d;
+  }
+};
+
+// 单个阶段的测量结果
+struct StageResult {
+  std::string name;
+  double seconds = 0;
+  IoCounters io;
+};
+
+// 一次流水线运行的测量结果
+struct RunResult {
+  size_t datasetMB = 0;
+  size_t cacheKB = 0;
+  size_t threads = 0;
+  size_t inputBytes = 0;
+  size_t records = 0;
+  size_t peakRssKB = 0;
+  std::vector<StageResult> stages;
+};
+
+// 基准测试参数
+struct BenchOptions {
+  std::vector<size_t> sizesMB = {16, 64};
+  std::vector<size_t> cacheKB = {512, 4096};
+  std::vector<size_t> threads = {
+      1, std::max(1u, std::thread::hardware_concurrency())};
+  size_t ioDepth = 4;
+  uint64_t seed = 1;
+  Distribution distribution = Distribution::Uniform;
+  std::string dir = "./bench";
+  std::string json; // 为空时写入 dir/bench.json
+};
+
+IoCounters readIoCounters() {
+  IoCounters io;
+  std::ifstream in("/proc/self/io");
+  std::string key;
+  uint64_t value;
+  while (in >> key >> value) {
+    if (key == "rchar:")
+      io.rchar = value;
+    else if (key == "wchar:")
+      io.wchar = value;
+    else if (key == "read_bytes:")
+      io.readBytes = value;
+    else if (key == "write_bytes:")
+      io.writeBytes = value;
+  }
+  return io;
+}
+
+// 读取进程的峰值常驻内存（VmHWM，单位 KB）
+size_t readPeakRssKB() {
+  std::ifstream in("/proc/self/status");
+  std::string line;
+  while (std::getline(in, line)) {
+    if (line.rfind("VmHWM:", 0) == 0)
+      return std::stoull(line.substr(6));
+  }
+  return 0;
+}
+
+// 重置峰值常驻内存，使每次运行单独统计；内核不支持时保持进程级峰值
+void resetPeakRss() {
+  std::ofstream out("/proc/self/clear_refs");
+  if (out)
+    out << "5";
+}
+
+// 解析逗号分隔的数字列表
+std::vector<size_t> parseList(const std::string &list) {
+  std::vector<size_t> values;
+  std::stringstream ss(list);
+  std::string item;
+  while (std::getline(ss, item, ','))
+    values.push_back(std::stoull(item));
+  return values;
+}
+
+// 统计数据集中的记录数（每行一个整数）
+size_t countRecords(const std::vector<std::string> &files, size_t &bytes) {
+  size_t records = 0;
+  bytes = 0;
+  std::vector<char> buffer(4 * 1024 * 1024);
+  for (const auto &file : files) {
+    std::ifstream in(file, std::ios::binary);
+    while (in.read(buffer.data(), buffer.size()) || in.gcount() > 0) {
+      size_t n = in.gcount();
+      bytes += n;
+      records += std::count(buffer.data(), buffer.data() + n, '\n');
+    }
+  }
+  return records;
+}
+
+// 生成或复用指定大小的数据集，返回数据集目录
+std::string prepareDataset(const BenchOptions &options, size_t sizeMB) {
+  std::string dataDir = options.dir + "/data_" + std::to_string(sizeMB) +
+                        "M_" + distributionName(options.distribution) + "_" +
+                        std::to_string(options.seed);
+  if (fs::exists(dataDir))
+    return dataDir;
+
+  GeneratorOptions gen;
+  gen.outputDir = dataDir + ".tmp";
+  gen.totalSize = sizeMB * 1024 * 1024;
+  gen.seed = options.seed;
+  gen.distribution = options.distribution;
+  fs::remove_all(gen.outputDir);
+  generateFiles(gen);
+  fs::rename(gen.outputDir, dataDir);
+  return dataDir;
+}
+
+// 计时并记录一个阶段
+template <typename F> StageResult measure(const std::string &name, F &&f) {
+  StageResult stage;
+  stage.name = name;
+  IoCounters before = readIoCounters();
+  auto start = std::chrono::steady_clock::now();
+  f();
+  auto end = std::chrono::steady_clock::now();
+  stage.seconds = std::chrono::duration<double>(end - start).count();
+  stage.io = readIoCounters() - before;
+  return stage;
+}
+
+RunResult runPipeline(const BenchOptions &options, const std::string &dataDir,
+                      size_t sizeMB, size_t cacheKB, size_t threads) {
+  RunResult run;
+  run.datasetMB = sizeMB;
+  run.cacheKB = cacheKB;
+  run.threads = threads;
+
+  // 流水线会在输入目录中生成中间文件，因此每次在数据集的副本上运行
+  std::string workDir = options.dir + "/work";
+  fs::remove_all(workDir);
+  fs::create_directories(workDir);
+  std::vector<std::string> inputs;
+  for (const auto &file : listInputFiles(dataDir)) {
+    std::string target = workDir + "/" + fs::path(file).filename().string();
+    fs::copy_file(file, target);
+    inputs.push_back(target);
+  }
+  run.records = countRecords(inputs, run.inputBytes);
+
+  resetPeakRss();
+  Executors executors(options.ioDepth, threads);
+  std::queue<std::string> file_que;
+  std::queue<std::vector<std::string>> mergeLog;
+  std::string finalFile;
+
+  run.stages.push_back(measure("split", [&]() {
+    file_que = splitStage(executors, inputs, cacheKB);
+  }));
+  run.stages.push_back(measure("sort", [&]() {
+    file_que = sortStage(executors, std::move(file_que));
+  }));
+  run.stages.push_back(measure("merge", [&]() {
+    finalFile = mergeStage(executors, std::move(file_que), mergeLog, cacheKB);
+  }));
+  run.stages.push_back(measure("bin2Text", [&]() {
+    if (!finalFile.empty())
+      bin2Text(finalFile, cacheKB);
+  }));
+
+  // 整条流水线为各阶段之和
+  StageResult total;
+  total.name = "pipeline";
+  for (const auto &stage : run.stages) {
+    total.seconds += stage.seconds;
+    total.io.rchar += stage.io.rchar;
+    total.io.wchar += stage.io.wchar;
+    total.io.readBytes += stage.io.readBytes;
+    total.io.writeBytes += stage.io.writeBytes;
+  }
+  run.stages.push_back(total);
+  run.peakRssKB = readPeakRssKB();
+
+  fs::remove_all(workDir);
+  return run;
+}
+
+void printRun(const RunResult &run) {
+  for (const auto &stage : run.stages) {
+    double mb = run.inputBytes / (1024.0 * 1024.0);
+    std::cout << std::left << std::setw(8) << run.datasetMB << std::setw(8)
+              << run.cacheKB << std::setw(8) << run.threads << std::setw(10)
+              << stage.name << std::right << std::fixed << std::setprecision(3)
+              << std::setw(10) << stage.seconds << std::setw(12)
+              << mb / stage.seconds << std::setw(14)
+              << run.records / stage.seconds << std::setw(12)
+              << stage.io.rchar / (1024 * 1024) << std::setw(12)
+              << stage.io.wchar / (1024 * 1024) << std::setw(12)
+              << run.peakRssKB / 1024 << std::endl;
+  }
+}
+
+// 每秒速率；耗时测得为 0 时没有意义，输出 null（JSON 不能表示 inf）
+std::string jsonRate(double amount, double seconds) {
+  if (seconds <= 0)
+    return "null";
+  std::ostringstream rate;
+  rate << amount / seconds;
+  return rate.str();
+}
+
+void writeJson(const BenchOptions &options,
+               const std::vector<RunResult> &runs) {
+  std::ofstream out(options.json, std::ios::trunc);
+  if (!out) {
+    std::cerr << "无法创建文件：" << options.json << std::endl;
+    return;
+  }
+
+  out << "{\n";
+  out << "  \"compiler\": \"" << __VERSION__ << "\",\n";
+#ifdef __OPTIMIZE__
+  out << "  \"optimized\": true,\n";
+#else
+  out << "  \"optimized\": false,\n";
+#endif
+  out << "  \"seed\": " << options.seed << ",\n";
+  out << "  \"distribution\": \"" << distributionName(options.distribution)
+      << "\",\n";
+  out << "  \"io_depth\": " << options.ioDepth << ",\n";
+  out << "  \"runs\": [\n";
+  for (size_t i = 0; i < runs.size(); ++i) {
+    const RunResult &run = runs[i];
+    out << "    {\"dataset_mb\": " << run.datasetMB
+        << ", \"cache_kb\": " << run.cacheKB << ", \"threads\": " << run.threads
+        << ", \"input_bytes\": " << run.inputBytes
+        << ", \"records\": " << run.records
+        << ", \"peak_rss_kb\": " << run.peakRssKB << ",\n";
+    out << "     \"stages\": [\n";
+    for (size_t j = 0; j < run.stages.size(); ++j) {
+      const StageResult &stage = run.stages[j];
+      out << "       {\"name\": \"" << stage.name
+          << "\", \"seconds\": " << stage.seconds
+          << ", \"mb_per_s\": "
+          << jsonRate(run.inputBytes / 1048576.0, stage.seconds)
+          << ", \"records_per_s\": " << jsonRate(run.records, stage.seconds)
+          << ", \"bytes_read\": " << stage.io.rchar
+          << ", \"bytes_written\": " << stage.io.wchar
+          << ", \"storage_read\": " << stage.io.readBytes
+          << ", \"storage_written\": " << stage.io.writeBytes << "}"
+          << (j + 1 < run.stages.size() ? "," : "") << "\n";
+    }
+    out << "     ]}" << (i + 1 < runs.size() ? "," : "") << "\n";
+  }
+  out << "  ]\n}\n";
+}
+
+void usage(const char *prog) {
+  std::cerr << "Usage: " << prog
+            << " [--sizes MB,MB] [--cache KB,KB] [--threads N,N]"
+               " [--io-depth N] [--seed N] [--dist NAME] [--dir DIR]"
+               " [--json FILE]"
+            << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+  BenchOptions options;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (i + 1 >= argc) {
+      usage(argv[0]);
+      return 1;
+    }
+    std::string value = argv[++i];
+    if (arg == "--sizes")
+      options.sizesMB = parseList(value);
+    else if (arg == "--cache")
+      options.cacheKB = parseList(value);
+    else if (arg == "--threads")
+      options.threads = parseList(value);
+    else if (arg == "--io-depth")
+      options.ioDepth = std::stoull(value);
+    else if (arg == "--seed")
+      options.seed = std::stoull(value);
+    else if (arg == "--dir")
+      options.dir = value;
+    else if (arg == "--json")
+      options.json = value;
+    else if (arg == "--dist") {
+      if (!parseDistribution(value, options.distribution)) {
+        usage(argv[0]);
+        return 1;
+      }
+    } else {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+  if (options.json.empty())
+    options.json = options.dir + "/bench.json";
+
+  fs::create_directories(options.dir);
+  std::cout << std::left << std::setw(8) << "MB" << std::setw(8) << "cacheKB"
+            << std::setw(8) << "threads" << std::setw(10) << "stage"
+            << std::right << std::setw(10) << "seconds" << std::setw(12)
+            << "MB/s" << std::setw(14) << "records/s" << std::setw(12)
+            << "readMB" << std::setw(12) << "writeMB" << std::setw(12)
+            << "peakRssMB" << std::endl;
+
+  std::vector<RunResult> runs;
+  for (size_t sizeMB : options.sizesMB) {
+    std::string dataDir = prepareDataset(options, sizeMB);
+    for (size_t cacheKB : options.cacheKB) {
+      for (size_t threads : options.threads) {
+        runs.push_back(runPipeline(options, dataDir, sizeMB, cacheKB, threads));
+        printRun(runs.back());
+      }
+    }
+  }
+
+  writeJson(options, runs);
+  std::cout << "Results written to " << options.json << std::endl;
+  return 0;
+}
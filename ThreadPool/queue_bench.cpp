@@ -0,0 +1,77 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ThreadPool.h"
+
+// 线程池任务队列的竞争基准测试：
+// P 个生产者线程同时向线程池提交空任务，测量提交吞吐与端到端完成时间，
+// 对比互斥锁 + 条件变量队列与无锁 MPMC 环形队列
+
+struct BenchResult {
+  double submitSeconds; // 所有生产者提交完毕所用时间
+  double totalSeconds;  // 所有任务执行完毕所用时间
+};
+
+template <typename Pool>
+BenchResult runBench(size_t workers, size_t producers,
+                     size_t tasksPerProducer) {
+  Pool pool(workers);
+  std::atomic<size_t> done(0);
+  std::atomic<bool> go(false);
+
+  std::vector<std::thread> threads;
+  for (size_t p = 0; p < producers; ++p) {
+    threads.emplace_back([&]() {
+      while (!go.load(std::memory_order_acquire))
+        std::this_thread::yield();
+      for (size_t i = 0; i < tasksPerProducer; ++i)
+        pool.post([&done]() { done.fetch_add(1, std::memory_order_relaxed); });
+    });
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  go.store(true, std::memory_order_release);
+  for (auto &t : threads)
+    t.join();
+  auto submitted = std::chrono::steady_clock::now();
+
+  while (!pool.finish())
+    std::this_thread::yield();
+  auto end = std::chrono::steady_clock::now();
+
+  return {std::chrono::duration<double>(submitted - start).count(),
+          std::chrono::duration<double>(end - start).count()};
+}
+
+int main(int argc, char *argv[]) {
+  // 第一个参数为每个生产者提交的任务数，默认 100000
+  // 第二个参数为工作线程数，默认为硬件核心数
+  size_t tasksPerProducer = argc > 1 ? std::stoull(argv[1]) : 100000;
+  size_t workers = argc > 2 ? std::stoull(argv[2])
+                            : std::max(1u, std::thread::hardware_concurrency());
+
+  std::printf("%-10s %-10s %14s %14s %14s\n", "queue", "producers",
+              "submit Mops/s", "total Mops/s", "total s");
+  for (size_t producers = 1; producers <= 64; producers *= 2) {
+    size_t total = producers * tasksPerProducer;
+
+    BenchResult m =
+        runBench<ThreadPool>(workers, producers, tasksPerProducer);
+    std::printf("%-10s %-10zu %14.3f %14.3f %14.3f\n", "mutex", producers,
+                total / m.submitSeconds / 1e6, total / m.totalSeconds / 1e6,
+                m.totalSeconds);
+
+    BenchResult r =
+        runBench<LockFreeThreadPool>(workers, producers, tasksPerProducer);
+    std::printf("%-10s %-10zu %14.3f %14.3f %14.3f\n", "ring", producers,
+                total / r.submitSeconds / 1e6, total / r.totalSeconds / 1e6,
+                r.totalSeconds);
+  }
+
+  return 0;
+}